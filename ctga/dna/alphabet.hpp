@@ -0,0 +1,134 @@
+// alphabet.hpp ---
+//
+// Filename: alphabet.hpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-12T13:10:27+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+
+#ifndef CTGA_DNA_ALPHABET_HPP_
+#define CTGA_DNA_ALPHABET_HPP_
+
+#include "ctga/dna/base.hpp"
+
+namespace ctga {
+namespace dna {
+
+/**
+ *  \brief Pure DNA: A, C, G and T on 2 bits
+ *
+ *  An alphabet policy gives the number of symbols (size), the width of their
+ *  codes (bits), how codes are compared (sets: true if two codes match when
+ *  they share a bit, false if they have to be equal) and how to encode the
+ *  symbols (code returns -1 for symbols outside of the alphabet).
+ */
+struct DNA4 {
+  static constexpr unsigned size = 4;
+  static constexpr unsigned bits = 2;
+  static constexpr bool sets = false;
+  static constexpr bool nucleic = true;
+  static constexpr const char* symbols = "ACGT";
+
+  static constexpr int code(Base b) {
+    return b <= Base::T ? static_cast<int>(b) : -1;
+  }
+
+  static constexpr int code(char c) {
+    return c == 'A' ? 0 : c == 'C' ? 1 : c == 'G' ? 2 : c == 'T' ? 3 : -1;
+  }
+};
+
+/** \brief Pure RNA: A, C, G and U on 2 bits */
+struct RNA4 {
+  static constexpr unsigned size = 4;
+  static constexpr unsigned bits = 2;
+  static constexpr bool sets = false;
+  static constexpr bool nucleic = true;
+  static constexpr const char* symbols = "ACGU";
+
+  static constexpr int code(Base b) { return DNA4::code(b); }
+
+  static constexpr int code(char c) {
+    return c == 'A' ? 0 : c == 'C' ? 1 : c == 'G' ? 2 : c == 'U' ? 3 : -1;
+  }
+};
+
+/**
+ *  \brief The 15 IUPAC nucleotide symbols on 4 bits
+ *
+ *  Codes are the sets of nucleotides (@see nucleotides), so that two
+ *  symbols match when their codes intersect.
+ */
+struct IUPAC15 {
+  static constexpr unsigned size = 15;
+  static constexpr unsigned bits = 4;
+  static constexpr bool sets = true;
+  static constexpr bool nucleic = true;
+  static constexpr const char* symbols = "ACGTMRWSYKVHDBN";
+
+  static constexpr int code(Base b) { return nucleotides(b); }
+
+  static constexpr int code(char c) {
+    for (auto i = 0U; i < size; ++i)
+      if (symbols[i] == c) return code(static_cast<Base>(i));
+    return -1;
+  }
+};
+
+/** \brief The 20 standard amino acids on 5 bits */
+struct Protein20 {
+  static constexpr unsigned size = 20;
+  static constexpr unsigned bits = 5;
+  static constexpr bool sets = false;
+  static constexpr bool nucleic = false;
+  static constexpr const char* symbols = "ACDEFGHIKLMNPQRSTVWY";
+
+  static constexpr int code(char c) {
+    for (auto i = 0U; i < size; ++i)
+      if (symbols[i] == c) return static_cast<int>(i);
+    return -1;
+  }
+};
+
+}  // namespace dna
+}  // namespace ctga
+
+#endif  // CTGA_DNA_ALPHABET_HPP_
+
+//
+// alphabet.hpp ends here
@@ -42,64 +42,20 @@
 
 #include "ctga/dna/base.hpp"
 
+#include <cctype>
 #include <iostream>
-#include <map>
 #include <unordered_set>
-#include <utility>
 
 namespace ctga {
 namespace dna {
 
-std::map<Base, std::unordered_set<Base>> base_matches =
-    boost::assign::map_list_of
-    (Base::A, std::unordered_set<Base>{Base::A})
-    (Base::C, std::unordered_set<Base>{Base::C})
-    (Base::G, std::unordered_set<Base>{Base::G})
-    (Base::T, std::unordered_set<Base>{Base::T})
-    (Base::M, std::unordered_set<Base>{Base::A, Base::C})
-    (Base::R, std::unordered_set<Base>{Base::A, Base::G})
-    (Base::W, std::unordered_set<Base>{Base::A, Base::T})
-    (Base::S, std::unordered_set<Base>{Base::C, Base::G})
-    (Base::Y, std::unordered_set<Base>{Base::C, Base::T})
-    (Base::K, std::unordered_set<Base>{Base::G, Base::T})
-    (Base::V, std::unordered_set<Base>{Base::A, Base::C, Base::G})
-    (Base::H, std::unordered_set<Base>{Base::A, Base::C, Base::T})
-    (Base::D, std::unordered_set<Base>{Base::A, Base::G, Base::T})
-    (Base::B, std::unordered_set<Base>{Base::C, Base::G, Base::T})
-    (Base::N, std::unordered_set<Base>{Base::A, Base::C, Base::G, Base::T});
-
-Base complement(const Base& b) {
-  Base sel;
-  switch (b) {
-    case Base::A: sel = Base::T; break;
-    case Base::G: sel = Base::C; break;
-    case Base::C: sel = Base::G; break;
-    case Base::T: sel = Base::A; break;
-    case Base::M: sel = Base::K; break;
-    case Base::R: sel = Base::Y; break;
-    case Base::W: sel = Base::W; break;
-    case Base::S: sel = Base::S; break;
-    case Base::Y: sel = Base::R; break;
-    case Base::K: sel = Base::M; break;
-    case Base::V: sel = Base::B; break;
-    case Base::H: sel = Base::D; break;
-    case Base::D: sel = Base::H; break;
-    case Base::B: sel = Base::V; break;
-    case Base::N: sel = Base::N; break;
-  }
-  return sel;
-}
-
 std::unordered_set<Base> match(const Base& a, const Base& b) {
+  static constexpr Base nucleotide_bases[] = {Base::A, Base::C, Base::G,
+                                               Base::T};
   std::unordered_set<Base> res{};
-  if (a == b) {
-    res = base_matches[a];
-  } else {
-    for (const auto& elt : base_matches[a]) {
-      if (base_matches[b].find(elt) != base_matches[b].end())
-        res.emplace(elt);
-    }
-  }
+  auto common = nucleotides(a) & nucleotides(b);
+  for (auto i = 0U; i < 4; ++i)
+    if (common & (1U << i)) res.emplace(nucleotide_bases[i]);
   return res;
 }
 
@@ -128,7 +84,8 @@ std::ostream& operator<<(std::ostream& os, const Base& b) {
 std::istream& operator>>(std::istream& is, Base& b) {
   char c{};
   is >> c;
-  switch (c) {
+  // Soft-masked (lowercase) bases are read as regular ones
+  switch (std::toupper(static_cast<unsigned char>(c))) {
     case 'A': b = Base::A; break;
     case 'C': b = Base::C; break;
     case 'G': b = Base::G; break;
@@ -44,8 +44,6 @@
 #ifndef CTGA_DNA_BASE_HPP_
 #define CTGA_DNA_BASE_HPP_
 
-#include <boost/assign.hpp>
-
 #include <algorithm>
 #include <iterator>
 #include <iostream>
@@ -59,6 +57,13 @@
 
 /** \namespace ctga::dna
  * Contains all the tools relating to the DNA itself
+ *
+ * All the const operations of the module (base matching, distances,
+ * similarity searches, scoring) only read immutable tables and the objects
+ * they are called on: they can be used concurrently from several threads
+ * without locking. Operations needing randomness take their random engine as
+ * a parameter; the overloads falling back on the global
+ * tools::RandomGenerator are not thread-safe.
  */
 
 namespace ctga {
@@ -82,13 +87,53 @@ enum class Base : unsigned {
   N /*!< Any base */
 };
 
+namespace detail {
+/** \brief Nucleotides represented by each base (A = 1, C = 2, G = 4, T = 8) */
+constexpr unsigned char base_nucleotides[] = {
+  0x1, 0x2, 0x4, 0x8,                     // A C G T
+  0x3, 0x5, 0x9, 0x6, 0xA, 0xC,           // M R W S Y K
+  0x7, 0xB, 0xD, 0xE,                     // V H D B
+  0xF};                                   // N
+
+/** \brief Complement of each base */
+constexpr Base base_complements[] = {
+  Base::T, Base::G, Base::C, Base::A,
+  Base::K, Base::Y, Base::W, Base::S, Base::R, Base::M,
+  Base::B, Base::D, Base::H, Base::V,
+  Base::N};
+}  // namespace detail
+
+/**
+ *  \brief Get the set of nucleotides a base stands for
+ *
+ *  \param b Base
+ *  \return Bitmask of the nucleotides (A = 1, C = 2, G = 4, T = 8)
+ */
+constexpr unsigned char nucleotides(const Base& b) {
+  return detail::base_nucleotides[static_cast<unsigned>(b)];
+}
 
-Base complement(const Base& b);
+/**
+ *  \brief Get the complement of a base
+ *
+ *  \param b Base
+ *  \return Complementary base
+ */
+constexpr Base complement(const Base& b) {
+  return detail::base_complements[static_cast<unsigned>(b)];
+}
 
 std::unordered_set<Base> match(const Base& a, const Base& b);
 
-inline bool compatible(const Base& a, const Base& b) {
-  return match(a, b).size() > 0;
+/**
+ *  \brief Check if two bases have at least one nucleotide in common
+ *
+ *  \param a First base
+ *  \param b Second base
+ *  \return True if the bases are compatible
+ */
+constexpr bool compatible(const Base& a, const Base& b) {
+  return (nucleotides(a) & nucleotides(b)) != 0;
 }
 
 /** \brief Write a Base into a stream */
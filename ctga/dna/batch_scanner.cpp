@@ -0,0 +1,100 @@
+// batch_scanner.cpp ---
+//
+// Filename: batch_scanner.cpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-19T11:06:52+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+#include "ctga/dna/batch_scanner.hpp"
+
+namespace ctga {
+namespace dna {
+
+BatchScanner::BatchScanner(const Sequence& seq, const Mask& mask) :
+    codes_{seq, mask} {}
+
+Eigen::VectorXd BatchScanner::weights(const PWM& pwm) {
+  const auto& values = pwm.values();
+  Eigen::VectorXd res(4 * pwm.size());
+  for (auto j = 0U; j < pwm.size(); ++j)
+    res.segment(4 * j, 4) = values.col(j);
+  return res;
+}
+
+Eigen::VectorXd BatchScanner::rev_weights(const PWM& pwm) {
+  // Base b at position j of the window is scored as its complement (3 - b)
+  // at position width - 1 - j of the PWM
+  const auto& values = pwm.values();
+  auto width = pwm.size();
+  Eigen::VectorXd res(4 * width);
+  for (auto j = 0U; j < width; ++j)
+    for (auto b = 0U; b < 4; ++b)
+      res(4 * j + b) = values(3 - b, width - 1 - j);
+  return res;
+}
+
+Eigen::VectorXd BatchScanner::weights(const Sequence& motif) {
+  Eigen::VectorXd res(4 * motif.size());
+  for (auto j = 0U; j < motif.size(); ++j)
+    for (auto b = 0U; b < 4; ++b)
+      res(4 * j + b) = compatible(motif[j], static_cast<Base>(b)) ? 1. : 0.;
+  return res;
+}
+
+void BatchScanner::encode(unsigned first, unsigned rows, unsigned width,
+                          Tile* tile, Eigen::ArrayXd* valid) const {
+  tile->topRows(rows).setZero();
+  const auto* codes = codes_.data() + first;
+  for (auto r = 0U; r < rows; ++r) {
+    (*valid)(r) = 1.;
+    for (auto j = 0U; j < width; ++j) {
+      auto code = codes[r + j];
+      if (code == CodedSequence::invalid) {
+        (*valid)(r) = 0.;
+        break;
+      }
+      (*tile)(r, 4 * j + code) = 1.;
+    }
+  }
+}
+
+}  // namespace dna
+}  // namespace ctga
+
+//
+// batch_scanner.cpp ends here
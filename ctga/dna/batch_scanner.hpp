@@ -0,0 +1,166 @@
+// batch_scanner.hpp ---
+//
+// Filename: batch_scanner.hpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-19T11:06:52+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+
+#ifndef CTGA_DNA_BATCH_SCANNER_HPP_
+#define CTGA_DNA_BATCH_SCANNER_HPP_
+
+#include <eigen3/Eigen/Core>
+#include <algorithm>
+#include <cassert>
+
+#include "ctga/dna/mask.hpp"
+#include "ctga/dna/pwm.hpp"
+#include "ctga/dna/quantized_pwm.hpp"
+#include "ctga/dna/sequence.hpp"
+
+namespace ctga {
+namespace dna {
+
+/**
+ *  \brief Scores the windows of a sequence against many weight vectors at
+ *  once
+ *
+ *  The windows are one-hot encoded, row i holding a 1 in column
+ *  4 * j + code of base i + j, a tile of them at a time. Each tile is
+ *  multiplied by a matrix with a column per weight vector (a PWM, its
+ *  reverse complement, a motif...), so that the sequence is read once for
+ *  all of them and most of the work is a single GEMM per tile.
+ */
+class BatchScanner {
+ public:
+  /** \brief Number of windows encoded in a tile */
+  static constexpr unsigned tile_size = 256;
+
+  /** \brief One-hot encoded windows, a window per row */
+  using Tile = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic,
+                             Eigen::RowMajor>;
+
+  /**
+   *  \brief Prepare the scan of a sequence
+   *
+   *  \param seq Sequence to scan
+   *  \param mask Regions of the sequence to skip, the ambiguous bases being
+   *  always skipped
+   */
+  BatchScanner(const Sequence& seq, const Mask& mask);
+
+  /**
+   *  \brief Get the length of the sequence
+   *
+   *  \return Number of bases
+   */
+  inline unsigned size() const { return codes_.size(); }
+
+  /**
+   *  \brief Get the weights scoring windows with a PWM
+   *
+   *  \param pwm PWM
+   *  \return Column of 4 * pwm.size() weights
+   */
+  static Eigen::VectorXd weights(const PWM& pwm);
+
+  /**
+   *  \brief Get the weights scoring the reverse complement of windows with a
+   *  PWM
+   *
+   *  \param pwm PWM
+   *  \return Column of 4 * pwm.size() weights
+   */
+  static Eigen::VectorXd rev_weights(const PWM& pwm);
+
+  /**
+   *  \brief Get the weights counting the bases of windows compatible with a
+   *  motif
+   *
+   *  \param motif Motif
+   *  \return Column of 4 * motif.size() weights
+   */
+  static Eigen::VectorXd weights(const Sequence& motif);
+
+  /**
+   *  \brief Score the windows against a matrix of weights
+   *
+   *  Windows start from 0 to size() - width included. They are reported a
+   *  tile at a time, so that the caller can reduce the scores column by
+   *  column.
+   *
+   *  \param weights Matrix of 4 * width rows, a column per weight vector
+   *  \param f Function called as f(first, rows, scores, valid) for each
+   *  tile: row r of scores holds the scores of the window starting at
+   *  first + r, for r < rows, and valid(r) is 0 if the window overlaps a
+   *  skipped region, 1 otherwise
+   */
+  template <typename F>
+  void scan(const Eigen::MatrixXd& weights, F f) const {
+    unsigned width = weights.rows() / 4;
+    assert(weights.rows() == 4 * width);
+    if (width == 0 || size() < width) return;
+
+    auto n = size() - width + 1;
+    Tile tile(tile_size, weights.rows());
+    Eigen::MatrixXd scores(tile_size, weights.cols());
+    Eigen::ArrayXd valid(tile_size);
+    for (auto first = 0U; first < n; first += tile_size) {
+      auto rows = std::min(tile_size, n - first);
+      encode(first, rows, width, &tile, &valid);
+      scores.topRows(rows).noalias() = tile.topRows(rows) * weights;
+      f(first, rows, scores, valid);
+    }
+  }
+
+ private:
+  CodedSequence codes_; /*!< Bases, invalid where skipped */
+
+  // One-hot encode the windows [first, first + rows) into the first rows of
+  // the tile, flagging the windows with a skipped base
+  void encode(unsigned first, unsigned rows, unsigned width, Tile* tile,
+              Eigen::ArrayXd* valid) const;
+};
+
+}  // namespace dna
+}  // namespace ctga
+
+#endif  // CTGA_DNA_BATCH_SCANNER_HPP_
+
+//
+// batch_scanner.hpp ends here
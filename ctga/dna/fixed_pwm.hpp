@@ -0,0 +1,217 @@
+// fixed_pwm.hpp ---
+//
+// Filename: fixed_pwm.hpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-20T09:48:31+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+
+#ifndef CTGA_DNA_FIXED_PWM_HPP_
+#define CTGA_DNA_FIXED_PWM_HPP_
+
+#include <eigen3/Eigen/Core>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "ctga/dna/base.hpp"
+#include "ctga/dna/sequence.hpp"
+#include "ctga/tools/statistics.hpp"
+
+namespace ctga {
+namespace dna {
+
+/**
+ *  \brief PWM whose width is known at compile time
+ *
+ *  The values are held in a fixed size matrix, so that a FixedPWM lives on
+ *  the stack and is built from the parameters of an optimiser without any
+ *  allocation. Scoring loops have a constant trip count and are unrolled.
+ *
+ *  \tparam Width Number of columns
+ *  \tparam Scalar Type of the values: double or float for log-odds values,
+ *  an integer type for quantized ones (@see quantized)
+ */
+template <unsigned Width, typename Scalar = double>
+class FixedPWM {
+ public:
+  /** \brief Values, a row per base (A, C, G, T) and a column per position */
+  using Values = Eigen::Matrix<Scalar, 4, Width>;
+
+  /**
+   *  \brief Builds a PWM from probabilities, with a uniform background
+   *
+   *  \param probas 4 * Width probabilities, column after column
+   */
+  explicit FixedPWM(const Eigen::VectorXd& probas) :
+      FixedPWM{probas, {{0.25, 0.25, 0.25, 0.25}}} {}
+
+  /**
+   *  \brief Builds a PWM from probabilities
+   *
+   *  \param probas 4 * Width probabilities, column after column
+   *  \param background Frequencies of A, C, G and T
+   */
+  FixedPWM(const Eigen::VectorXd& probas,
+           const std::array<double, 4>& background) : values_{} {
+    static_assert(std::is_floating_point<Scalar>::value,
+                  "Log-odds values need a floating point type");
+    if (probas.size() != 4 * Width)
+      throw std::runtime_error{"Wrong number of parameters for the PWM"};
+
+    Eigen::Matrix<double, 4, 1> col{};
+    for (auto j = 0U; j < Width; ++j) {
+      col = probas.template segment<4>(4 * j);
+      tools::statistics::normalise_inplace(col, 0.001);
+      for (auto b = 0U; b < 4; ++b)
+        values_(b, j) = Scalar(std::log2(col[b] / background[b]));
+    }
+  }
+
+  /**
+   *  \brief Builds a PWM from its values
+   *
+   *  \param values Values
+   *  \return PWM
+   */
+  static FixedPWM from_values(const Values& values) {
+    FixedPWM res{};
+    res.values_ = values;
+    return res;
+  }
+
+  /**
+   *  \brief Get the width of the PWM
+   *
+   *  \return Number of columns
+   */
+  static constexpr unsigned size() { return Width; }
+
+  /**
+   *  \brief Get the values
+   *
+   *  \return Values
+   */
+  inline const Values& values() const { return values_; }
+
+  /**
+   *  \brief Score the window of a sequence starting at a given position
+   *
+   *  \param sequence Sequence containing the window, without ambiguous bases
+   *  \param pos Position of the first base of the window
+   *  \return Score of the window
+   */
+  Scalar score(const Sequence& sequence, unsigned pos) const {
+    return score(sequence, pos, std::make_index_sequence<Width>{});
+  }
+
+  /**
+   *  \brief Score a window packed on 2 bits
+   *
+   *  \param window Bases of the window on 2 bits, the first one in the lowest
+   *  bits (@see PackedSequence)
+   *  \return Score of the window
+   */
+  Scalar score(std::uint64_t window) const {
+    static_assert(Width <= 32, "Windows are packed in 64 bits");
+    return score(window, std::make_index_sequence<Width>{});
+  }
+
+  /**
+   *  \brief Get the consensus of the PWM
+   *
+   *  \return Sequence of the best base of each column
+   */
+  Sequence consensus() const {
+    std::vector<Base> res(Width);
+    for (auto j = 0U; j < Width; ++j) {
+      Eigen::Index best{};
+      values_.col(j).maxCoeff(&best);
+      res[j] = static_cast<Base>(best);
+    }
+    return Sequence{std::move(res)};
+  }
+
+  /**
+   *  \brief Quantize the values
+   *
+   *  \tparam Int Integer type of the quantized values
+   *  \param scale Factor applied to the values before rounding
+   *  \return Quantized PWM
+   */
+  template <typename Int>
+  FixedPWM<Width, Int> quantized(double scale) const {
+    typename FixedPWM<Width, Int>::Values res{};
+    for (auto j = 0U; j < Width; ++j)
+      for (auto b = 0U; b < 4; ++b)
+        res(b, j) = Int(std::lround(values_(b, j) * scale));
+    return FixedPWM<Width, Int>::from_values(res);
+  }
+
+ private:
+  FixedPWM() : values_{} {}
+
+  Values values_; /*!< Values of the PWM */
+
+  template <std::size_t... J>
+  Scalar score(const Sequence& sequence, unsigned pos,
+               std::index_sequence<J...>) const {
+    assert(((sequence[pos + J] <= Base::T) && ...));
+    return (Scalar{} + ... + values_(static_cast<unsigned>(sequence[pos + J]),
+                                     J));
+  }
+
+  template <std::size_t... J>
+  Scalar score(std::uint64_t window, std::index_sequence<J...>) const {
+    return (Scalar{} + ... + values_((window >> (2 * J)) & 3, J));
+  }
+
+  template <unsigned, typename> friend class FixedPWM;
+};
+
+}  // namespace dna
+}  // namespace ctga
+
+#endif  // CTGA_DNA_FIXED_PWM_HPP_
+
+//
+// fixed_pwm.hpp ends here
@@ -0,0 +1,170 @@
+// fixed_scan.hpp ---
+//
+// Filename: fixed_scan.hpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-13T09:41:27+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+
+#ifndef CTGA_DNA_FIXED_SCAN_HPP_
+#define CTGA_DNA_FIXED_SCAN_HPP_
+
+#include <array>
+#include <cstddef>
+#include <utility>
+
+#include "ctga/dna/base.hpp"
+#include "ctga/dna/sequence.hpp"
+
+namespace ctga {
+namespace dna {
+
+/** \brief Smallest motif width with a specialised scanner */
+constexpr unsigned fixed_min_width = 6;
+/** \brief Largest motif width with a specialised scanner */
+constexpr unsigned fixed_max_width = 16;
+/** \brief Largest tolerance with a specialised scanner */
+constexpr unsigned fixed_max_tolerance = 3;
+
+/**
+ *  \brief Go through the windows similar to a motif, width and tolerance
+ *  being known at compile time
+ *
+ *  The comparison of a window is fully unrolled and has no early exit, so
+ *  that the loop over the windows has no data dependent branch besides the
+ *  final test.
+ *
+ *  \tparam Width Width of the motif
+ *  \tparam Tolerance Number of errors allowed
+ *  \param seq Sequence to scan
+ *  \param motif Nucleotides of each base of the motif (@see nucleotides)
+ *  \param first First window start to test (included)
+ *  \param last Last window start to test (excluded)
+ *  \param f Function called as f(pos) for each similar window
+ */
+template <unsigned Width, unsigned Tolerance, typename F>
+void scan(const Sequence& seq, const unsigned char* motif,
+          unsigned first, unsigned last, F& f);
+
+namespace detail {
+template <unsigned Width, unsigned Tolerance, typename F, std::size_t... I>
+inline void scan_unrolled(const Sequence& seq, const unsigned char* motif,
+                          unsigned first, unsigned last, F& f,
+                          std::index_sequence<I...>) {
+  const std::array<unsigned char, Width> m{{motif[I]...}};
+  for (auto i = first; i < last; ++i) {
+    unsigned errors = (0U + ... + unsigned{
+        (nucleotides(seq[i + I]) & m[I]) == 0});
+    if (errors <= Tolerance) f(i);
+  }
+}
+
+/** \brief Signature of the specialised scanners */
+template <typename F>
+using FixedScanner = void (*)(const Sequence&, const unsigned char*,
+                              unsigned, unsigned, F&);
+
+constexpr unsigned fixed_tolerances = fixed_max_tolerance + 1;
+
+template <typename F, std::size_t... I>
+constexpr std::array<FixedScanner<F>, sizeof...(I)>
+make_fixed_scanners(std::index_sequence<I...>) {
+  return {{&scan<fixed_min_width + I / fixed_tolerances,
+                 I % fixed_tolerances, F>...}};
+}
+
+/** \brief Specialised scanners, indexed by width then tolerance */
+template <typename F>
+constexpr auto fixed_scanners = make_fixed_scanners<F>(
+    std::make_index_sequence<(fixed_max_width - fixed_min_width + 1)
+                             * fixed_tolerances>{});
+}  // namespace detail
+
+template <unsigned Width, unsigned Tolerance, typename F>
+void scan(const Sequence& seq, const unsigned char* motif,
+          unsigned first, unsigned last, F& f) {
+  detail::scan_unrolled<Width, Tolerance>(seq, motif, first, last, f,
+                                          std::make_index_sequence<Width>{});
+}
+
+/**
+ *  \brief Check if a query has a specialised scanner
+ *
+ *  \param width Width of the motif
+ *  \param tolerance Number of errors allowed
+ *  \return True if scan_fixed can handle the query
+ */
+constexpr bool has_fixed_scanner(unsigned width, unsigned tolerance) {
+  return width >= fixed_min_width && width <= fixed_max_width
+      && tolerance <= fixed_max_tolerance;
+}
+
+/**
+ *  \brief Go through the windows similar to a motif with the scanner
+ *  specialised on its width and tolerance
+ *
+ *  \param seq Sequence to scan
+ *  \param motif Motif to look for
+ *  \param tolerance Number of errors allowed
+ *  \param first First window start to test (included)
+ *  \param last Last window start to test (excluded)
+ *  \param f Function called as f(pos) for each similar window
+ *  \return False, without scanning, if no scanner is specialised for the
+ *  query (@see has_fixed_scanner)
+ */
+template <typename F>
+bool scan_fixed(const Sequence& seq, const Sequence& motif,
+                unsigned tolerance, unsigned first, unsigned last, F& f) {
+  auto width = motif.size();
+  if (!has_fixed_scanner(width, tolerance)) return false;
+
+  std::array<unsigned char, fixed_max_width> m{};
+  for (auto i = 0U; i < width; ++i) m[i] = nucleotides(motif[i]);
+  auto index = (width - fixed_min_width) * detail::fixed_tolerances
+               + tolerance;
+  detail::fixed_scanners<F>[index](seq, m.data(), first, last, f);
+  return true;
+}
+
+}  // namespace dna
+}  // namespace ctga
+
+#endif  // CTGA_DNA_FIXED_SCAN_HPP_
+
+//
+// fixed_scan.hpp ends here
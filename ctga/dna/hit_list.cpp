@@ -0,0 +1,61 @@
+// hit_list.cpp ---
+//
+// Filename: hit_list.cpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-05T08:31:55+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+#include "ctga/dna/hit_list.hpp"
+
+#include <vector>
+
+namespace ctga {
+namespace dna {
+
+std::vector<unsigned> HitList::to_vector() const {
+  std::vector<unsigned> res{};
+  res.reserve(size_);
+  res.insert(res.end(), begin(), end());
+  return res;
+}
+
+}  // namespace dna
+}  // namespace ctga
+
+//
+// hit_list.cpp ends here
@@ -0,0 +1,209 @@
+// hit_list.hpp ---
+//
+// Filename: hit_list.hpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-05T07:48:10+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+
+#ifndef CTGA_DNA_HIT_LIST_HPP_
+#define CTGA_DNA_HIT_LIST_HPP_
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+namespace ctga {
+namespace dna {
+
+/**
+ *  \brief Compressed list of increasing positions
+ *
+ *  Positions are stored as the difference with the previous one, encoded as
+ *  a variable length integer (7 bits per byte, the high bit flagging that
+ *  more bytes follow). Dense hit lists, as found when searching with a high
+ *  tolerance, take about one byte per hit instead of four. The list is read
+ *  back with a forward iterator decoding the positions on the fly.
+ */
+class HitList {
+ public:
+  /** \brief Forward iterator decoding the positions */
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = unsigned;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const unsigned*;
+    using reference = const unsigned&;
+
+    const_iterator() : data_{nullptr}, end_{nullptr}, value_{} {}
+    const_iterator(const std::uint8_t* data, const std::uint8_t* end) :
+        data_{data}, end_{end}, value_{} { decode(); }
+
+    inline reference operator*() const { return value_; }
+    inline pointer operator->() const { return &value_; }
+
+    inline const_iterator& operator++() {
+      decode();
+      return *this;
+    }
+
+    inline const_iterator operator++(int) {
+      auto res = *this;
+      decode();
+      return res;
+    }
+
+    inline bool operator==(const const_iterator& other) const {
+      return data_ == other.data_;
+    }
+
+    inline bool operator!=(const const_iterator& other) const {
+      return data_ != other.data_;
+    }
+
+   private:
+    const std::uint8_t* data_; /*!< Start of the current value */
+    const std::uint8_t* end_;  /*!< End of the encoded data */
+    const std::uint8_t* next_{nullptr}; /*!< Start of the next value */
+    unsigned value_;           /*!< Current decoded position */
+
+    // Move to the next encoded value and decode it
+    inline void decode() {
+      if (next_ != nullptr) data_ = next_;
+      if (data_ == end_) return;
+      unsigned delta{}, shift{};
+      auto pt = data_;
+      while (*pt & 0x80) {
+        delta |= static_cast<unsigned>(*pt++ & 0x7F) << shift;
+        shift += 7;
+      }
+      delta |= static_cast<unsigned>(*pt++) << shift;
+      next_ = pt;
+      value_ += delta;
+    }
+  };
+
+  /**
+   *  \brief Builds an empty list
+   */
+  HitList() : data_{}, size_{}, last_{} {}
+
+  /**
+   *  \brief Append a position
+   *
+   *  \param pos Position, not lower than the last one appended
+   */
+  inline void push_back(unsigned pos) {
+    assert(size_ == 0 || pos >= last_);
+    auto delta = pos - last_;
+    while (delta >= 0x80) {
+      data_.push_back(static_cast<std::uint8_t>(delta | 0x80));
+      delta >>= 7;
+    }
+    data_.push_back(static_cast<std::uint8_t>(delta));
+    last_ = pos;
+    ++size_;
+  }
+
+  /**
+   *  \brief Get the number of positions in the list
+   *
+   *  \return Number of positions
+   */
+  inline unsigned size() const { return size_; }
+
+  /**
+   *  \brief Check if the list is empty
+   *
+   *  \return True if there is no position in the list
+   */
+  inline bool empty() const { return size_ == 0; }
+
+  /**
+   *  \brief Get the memory used by the encoded positions
+   *
+   *  \return Number of bytes
+   */
+  inline std::size_t bytes() const { return data_.size(); }
+
+  /**
+   *  \brief Remove all the positions, keeping the allocated memory
+   */
+  inline void clear() {
+    data_.clear();
+    size_ = 0;
+    last_ = 0;
+  }
+
+  /**
+   *  \brief Release the memory not used by the encoded positions
+   */
+  inline void shrink_to_fit() { data_.shrink_to_fit(); }
+
+  inline const_iterator begin() const {
+    return const_iterator{data_.data(), data_.data() + data_.size()};
+  }
+
+  inline const_iterator end() const {
+    auto end = data_.data() + data_.size();
+    return const_iterator{end, end};
+  }
+
+  /**
+   *  \brief Decode all the positions
+   *
+   *  \return Vector of positions
+   */
+  std::vector<unsigned> to_vector() const;
+
+ private:
+  std::vector<std::uint8_t> data_; /*!< Encoded differences */
+  unsigned size_;                  /*!< Number of positions */
+  unsigned last_;                  /*!< Last position appended */
+};
+
+}  // namespace dna
+}  // namespace ctga
+
+#endif  // CTGA_DNA_HIT_LIST_HPP_
+
+//
+// hit_list.hpp ends here
@@ -0,0 +1,323 @@
+// kmer_spectrum.cpp ---
+//
+// Filename: kmer_spectrum.cpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-27T08:51:13+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+#include "ctga/dna/kmer_spectrum.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <future>
+#include <stdexcept>
+#include <vector>
+
+#include "ctga/dna/alphabet.hpp"
+#include "ctga/tools/thread_pool.hpp"
+
+namespace ctga {
+namespace dna {
+
+namespace {
+/** \brief Memory allowed for the counts of the parallel chunks */
+constexpr std::size_t max_chunk_memory = std::size_t{1} << 28;
+
+/**
+ *  \brief Call f on a k-mer and on every k-mer differing from it by at most
+ *  tolerance bases, at positions from col on
+ */
+template <typename F>
+void for_each_neighbour(std::uint32_t kmer, unsigned width, unsigned col,
+                        unsigned tolerance, F& f) {
+  f(kmer);
+  if (tolerance == 0) return;
+  for (; col < width; ++col) {
+    auto base = (kmer >> (2 * col)) & 3;
+    for (auto other = 0U; other < 4; ++other) {
+      if (other == base) continue;
+      auto neighbour = (kmer & ~(std::uint32_t{3} << (2 * col)))
+          | (other << (2 * col));
+      for_each_neighbour(neighbour, width, col + 1, tolerance - 1, f);
+    }
+  }
+}
+}  // namespace
+
+KmerSpectrum::KmerSpectrum(const Sequence& seq, const Mask& mask,
+                           unsigned width, unsigned threads) :
+    width_{width}, forward_{}, reverse_{} {
+  count({&seq}, {&mask}, threads);
+}
+
+KmerSpectrum::KmerSpectrum(const std::vector<Sequence>& records,
+                           unsigned width, unsigned threads) :
+    KmerSpectrum{records, std::vector<Mask>(records.size()), width,
+                 threads} {}
+
+KmerSpectrum::KmerSpectrum(const std::vector<Sequence>& records,
+                           const std::vector<Mask>& masks, unsigned width,
+                           unsigned threads) :
+    width_{width}, forward_{}, reverse_{} {
+  if (masks.size() != records.size())
+    throw std::runtime_error{"Each record needs a mask"};
+  std::vector<const Sequence*> seqs{};
+  std::vector<const Mask*> record_masks{};
+  for (auto r = 0U; r < records.size(); ++r) {
+    seqs.push_back(&records[r]);
+    record_masks.push_back(&masks[r]);
+  }
+  count(seqs, record_masks, threads);
+}
+
+void KmerSpectrum::count(const std::vector<const Sequence*>& records,
+                         const std::vector<const Mask*>& masks,
+                         unsigned threads) {
+  if (width_ == 0 || width_ > max_width)
+    throw std::runtime_error{"K-mers must have between 1 and 12 bases"};
+  auto entries = std::size_t{1} << (2 * width_);
+  forward_.assign(entries, 0);
+  reverse_.assign(entries, 0);
+
+  // Records are separated by an invalid base, so that no window spans two
+  // of them
+  std::vector<std::uint8_t> codes{};
+  std::vector<unsigned> starts{};
+  for (auto r = 0U; r < records.size(); ++r) {
+    CodedSequence coded{*records[r], *masks[r]};
+    starts.push_back(codes.size());
+    codes.insert(codes.end(), coded.data(), coded.data() + coded.size());
+    codes.push_back(CodedSequence::invalid);
+  }
+  if (codes.size() <= width_) return;
+
+  // Every valid window is counted on both strands, the windows missing at
+  // the ends of the records being removed afterwards
+  auto last = codes.size() - width_;
+  auto max_chunks = std::max<std::size_t>(
+      1, max_chunk_memory / (2 * entries * sizeof(std::uint32_t)));
+  auto chunks = std::max<std::size_t>(
+      1, std::min<std::size_t>({threads, last, max_chunks}));
+  const auto mask = static_cast<std::uint32_t>(entries - 1);
+  const auto top = 2 * (width_ - 1);
+  auto count_chunk = [&](std::size_t c, std::vector<std::uint32_t>* forward,
+                         std::vector<std::uint32_t>* reverse) {
+    auto first = last * c / chunks;
+    auto stop = last * (c + 1) / chunks;
+    std::uint32_t kmer{}, rev_kmer{};
+    unsigned valid{};
+    for (auto pos = first; pos < stop + width_ - 1; ++pos) {
+      std::uint32_t code = codes[pos];
+      if (code == CodedSequence::invalid) {
+        code = 0;
+        valid = 0;
+      } else {
+        ++valid;
+      }
+      kmer = (kmer >> 2) | (code << top);
+      rev_kmer = ((rev_kmer << 2) | (3 - code)) & mask;
+      if (valid < width_) continue;
+      ++(*forward)[kmer];
+      ++(*reverse)[rev_kmer];
+    }
+  };
+
+  if (chunks == 1) {
+    count_chunk(0, &forward_, &reverse_);
+  } else {
+    auto pool = tools::ThreadPool::get();
+    std::vector<std::vector<std::uint32_t>> forward(chunks), reverse(chunks);
+    std::vector<std::future<void>> futures{};
+    for (auto c = 0U; c < chunks; ++c) {
+      forward[c].assign(entries, 0);
+      reverse[c].assign(entries, 0);
+      futures.push_back(pool->submit([&count_chunk, &forward, &reverse, c] {
+            count_chunk(c, &forward[c], &reverse[c]);
+          }));
+    }
+    for (auto& f : futures) f.wait();
+    for (auto& f : futures) f.get();
+    for (auto c = 0U; c < chunks; ++c)
+      for (std::size_t kmer = 0; kmer < entries; ++kmer) {
+        forward_[kmer] += forward[c][kmer];
+        reverse_[kmer] += reverse[c][kmer];
+      }
+  }
+
+  // The last window of a record is only on the reverse strand, the first
+  // one only on the forward strand
+  auto packed = [&](std::size_t pos, std::uint32_t* kmer) {
+    *kmer = 0;
+    for (auto col = 0U; col < width_; ++col) {
+      if (codes[pos + col] == CodedSequence::invalid) return false;
+      *kmer |= std::uint32_t{codes[pos + col]} << (2 * col);
+    }
+    return true;
+  };
+  for (auto r = 0U; r < records.size(); ++r) {
+    auto size = records[r]->size();
+    if (size < width_) continue;
+    std::uint32_t kmer{};
+    if (packed(starts[r] + size - width_, &kmer)) --forward_[kmer];
+    if (packed(starts[r], &kmer)) --reverse_[rev_complement(kmer)];
+  }
+}
+
+std::uint32_t KmerSpectrum::pack(const Sequence& motif) const {
+  if (motif.size() != width_)
+    throw std::runtime_error{"Motif and k-mers have different widths"};
+  std::uint32_t res{};
+  for (auto col = 0U; col < width_; ++col) {
+    auto code = DNA4::code(motif[col]);
+    if (code < 0)
+      throw std::runtime_error{"Motif must only contain A, C, G and T"};
+    res |= static_cast<std::uint32_t>(code) << (2 * col);
+  }
+  return res;
+}
+
+ScanSummary KmerSpectrum::scan(const QuantizedPWM& pwm,
+                               double threshold) const {
+  if (pwm.size() != width_)
+    throw std::runtime_error{"PWM and k-mers have different widths"};
+  auto limit = pwm.quantize(threshold);
+  std::uint64_t hits{};
+  std::int64_t sum{};
+  for (std::uint32_t kmer = 0; kmer < forward_.size(); ++kmer) {
+    auto score = pwm.score(kmer);
+    std::int64_t occurrences = (score > limit)
+        * (forward_[kmer] + reverse_[kmer]);
+    hits += occurrences;
+    sum += occurrences * score;
+  }
+  return ScanSummary{static_cast<unsigned>(hits), sum / pwm.scale()};
+}
+
+unsigned KmerSpectrum::count_similar(const Sequence& motif,
+                                     unsigned tolerance) const {
+  auto kmer = pack(motif);
+  return neighbourhood(kmer, tolerance)
+      + neighbourhood(rev_complement(kmer), tolerance);
+}
+
+std::vector<std::uint32_t> KmerSpectrum::count_similar(
+    unsigned tolerance, unsigned threads) const {
+  auto entries = forward_.size();
+  auto levels = std::min(tolerance, width_) + 1;
+  // exact[e][kmer]: forward windows differing from kmer at e of the columns
+  // processed so far, and equal to it at the others
+  std::vector<std::vector<std::uint32_t>> exact(levels);
+  exact[0] = forward_;
+  for (auto e = 1U; e < levels; ++e) exact[e].assign(entries, 0);
+
+  auto groups = entries / 4;
+  auto chunks = std::max<std::size_t>(1, std::min<std::size_t>(threads,
+                                                               groups));
+  auto pool = tools::ThreadPool::get();
+  for (auto col = 0U; col < width_; ++col) {
+    const std::size_t stride = std::size_t{1} << (2 * col);
+    auto accumulate = [&](std::size_t first, std::size_t stop) {
+      for (auto g = first; g < stop; ++g) {
+        // First k-mer of the group, with an A at col
+        auto kmer = ((g & ~(stride - 1)) << 2) | (g & (stride - 1));
+        // Descending, so that the counts at e - 1 are still those of the
+        // previous columns
+        for (auto e = levels - 1; e > 0; --e) {
+          auto& above = exact[e];
+          const auto& below = exact[e - 1];
+          std::uint32_t sum = below[kmer] + below[kmer + stride]
+              + below[kmer + 2 * stride] + below[kmer + 3 * stride];
+          for (auto b = 0U; b < 4; ++b)
+            above[kmer + b * stride] += sum - below[kmer + b * stride];
+        }
+      }
+    };
+    if (chunks == 1) {
+      accumulate(0, groups);
+      continue;
+    }
+    std::vector<std::future<void>> futures{};
+    for (auto c = 0U; c < chunks; ++c)
+      futures.push_back(pool->submit([&accumulate, groups, chunks, c] {
+            accumulate(groups * c / chunks, groups * (c + 1) / chunks);
+          }));
+    for (auto& f : futures) f.wait();
+    for (auto& f : futures) f.get();
+  }
+
+  std::vector<std::uint32_t> within(entries, 0);
+  for (const auto& counts : exact)
+    for (std::size_t kmer = 0; kmer < entries; ++kmer)
+      within[kmer] += counts[kmer];
+  std::vector<std::uint32_t> res(entries);
+  for (std::uint32_t kmer = 0; kmer < entries; ++kmer)
+    res[kmer] = within[kmer] + within[rev_complement(kmer)];
+  return res;
+}
+
+Sequence KmerSpectrum::unpack(std::uint32_t kmer) const {
+  std::vector<Base> bases{};
+  for (auto col = 0U; col < width_; ++col) {
+    bases.push_back(static_cast<Base>(kmer & 3));
+    kmer >>= 2;
+  }
+  return Sequence{std::move(bases)};
+}
+
+std::uint32_t KmerSpectrum::rev_complement(std::uint32_t kmer) const {
+  std::uint32_t res{};
+  for (auto col = 0U; col < width_; ++col) {
+    res = (res << 2) | (3 - (kmer & 3));
+    kmer >>= 2;
+  }
+  return res;
+}
+
+std::uint64_t KmerSpectrum::neighbourhood(std::uint32_t kmer,
+                                          unsigned tolerance) const {
+  std::uint64_t res{};
+  auto add = [&](std::uint32_t neighbour) { res += forward_[neighbour]; };
+  for_each_neighbour(kmer, width_, 0, tolerance, add);
+  return res;
+}
+
+}  // namespace dna
+}  // namespace ctga
+
+//
+// kmer_spectrum.cpp ends here
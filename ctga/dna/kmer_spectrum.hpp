@@ -0,0 +1,233 @@
+// kmer_spectrum.hpp ---
+//
+// Filename: kmer_spectrum.hpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-27T08:51:13+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+
+
+#ifndef CTGA_DNA_KMER_SPECTRUM_HPP_
+#define CTGA_DNA_KMER_SPECTRUM_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include "ctga/dna/mask.hpp"
+#include "ctga/dna/quantized_pwm.hpp"
+#include "ctga/dna/sequence.hpp"
+
+namespace ctga {
+namespace dna {
+
+/**
+ *  \brief Number of occurrences of every k-mer of a sequence, on both
+ *  strands
+ *
+ *  The sequence is read once; the score of a PWM of width k, or the number
+ *  of windows similar to a motif, are then sums over the 4^k k-mers rather
+ *  than over the positions of the sequence, whatever its length.
+ *
+ *  The windows are those of the scans: the forward ones start before
+ *  size - k, the reverse ones match the forward starts from 1 to size - k.
+ *  Windows containing a masked or ambiguous base aren't counted. K-mers are
+ *  packed on 2 bits per base, the first base in the lowest bits.
+ *
+ *  Parallel chunks are tasks of the shared thread pool (@see
+ *  tools::ThreadPool::get): counting from one of its tasks could deadlock.
+ */
+class KmerSpectrum {
+ public:
+  /** \brief Widest k-mers counted */
+  static constexpr unsigned max_width = 12;
+
+  /**
+   *  \brief Count the k-mers of a sequence
+   *
+   *  \param seq Sequence
+   *  \param mask Regions of the sequence to skip
+   *  \param width Length of the k-mers
+   *  \param threads Number of chunks counted on the thread pool
+   */
+  KmerSpectrum(const Sequence& seq, const Mask& mask, unsigned width,
+               unsigned threads);
+
+  /**
+   *  \brief Count the k-mers of several records
+   *
+   *  No window spans two records.
+   *
+   *  \param records Sequences
+   *  \param width Length of the k-mers
+   *  \param threads Number of chunks counted on the thread pool
+   */
+  KmerSpectrum(const std::vector<Sequence>& records, unsigned width,
+               unsigned threads);
+
+  /**
+   *  \brief Count the k-mers of several records, each with its mask
+   *
+   *  No window spans two records.
+   *
+   *  \param records Sequences
+   *  \param masks Regions of each record to skip
+   *  \param width Length of the k-mers
+   *  \param threads Number of chunks counted on the thread pool
+   */
+  KmerSpectrum(const std::vector<Sequence>& records,
+               const std::vector<Mask>& masks, unsigned width,
+               unsigned threads);
+
+  /**
+   *  \brief Get the length of the k-mers
+   *
+   *  \return Length of the k-mers
+   */
+  inline unsigned width() const { return width_; }
+
+  /**
+   *  \brief Get the number of distinct k-mers
+   *
+   *  \return 4^width
+   */
+  inline unsigned size() const { return forward_.size(); }
+
+  /**
+   *  \brief Get the number of forward windows equal to a k-mer
+   *
+   *  \param kmer Packed k-mer
+   *  \return Occurrences on the forward strand
+   */
+  inline std::uint32_t forward(std::uint32_t kmer) const {
+    return forward_[kmer];
+  }
+
+  /**
+   *  \brief Get the number of reverse windows equal to a k-mer
+   *
+   *  \param kmer Packed k-mer
+   *  \return Occurrences on the reverse strand
+   */
+  inline std::uint32_t reverse(std::uint32_t kmer) const {
+    return reverse_[kmer];
+  }
+
+  /**
+   *  \brief Pack a motif
+   *
+   *  \param motif Motif of width() bases, A, C, G or T
+   *  \return Packed k-mer
+   */
+  std::uint32_t pack(const Sequence& motif) const;
+
+  /**
+   *  \brief Count the windows scoring above a threshold on both strands
+   *
+   *  Same result as QuantizedPWM::scan on both strands of the sequence.
+   *
+   *  \param pwm Quantized PWM of width() columns
+   *  \param threshold Windows must score strictly above it
+   *  \return Number of hits and sum of their scores
+   */
+  ScanSummary scan(const QuantizedPWM& pwm, double threshold) const;
+
+  /**
+   *  \brief Count the windows similar to a motif or to its reverse
+   *  complement
+   *
+   *  Same result as Sequence::count_similar: the k-mers within tolerance of
+   *  the motif are enumerated and their forward counts added.
+   *
+   *  \param motif Motif of width() bases
+   *  \param tolerance Number of mismatches allowed
+   *  \return Number of similar windows
+   */
+  unsigned count_similar(const Sequence& motif, unsigned tolerance) const;
+
+  /**
+   *  \brief Count the windows similar to every k-mer at once
+   *
+   *  The counts of the k-mers differing from each one at exactly e
+   *  positions are accumulated one column at a time: a column adds, to the
+   *  counts at e mismatches of each group of 4 k-mers differing only there,
+   *  the counts at e - 1 mismatches of the 3 other k-mers of the group. The
+   *  groups of a column are independent and split in parallel chunks, each
+   *  one going through the table sequentially.
+   *
+   *  \param tolerance Number of mismatches allowed
+   *  \param threads Number of chunks processed on the thread pool
+   *  \return For each packed k-mer, the result of count_similar
+   */
+  std::vector<std::uint32_t> count_similar(unsigned tolerance,
+                                           unsigned threads) const;
+
+  /**
+   *  \brief Unpack a k-mer
+   *
+   *  \param kmer Packed k-mer
+   *  \return Motif of width() bases
+   */
+  Sequence unpack(std::uint32_t kmer) const;
+
+  /**
+   *  \brief Pack the reverse complement of a packed k-mer
+   *
+   *  \param kmer Packed k-mer
+   *  \return Packed reverse complement
+   */
+  std::uint32_t rev_complement(std::uint32_t kmer) const;
+
+ private:
+  unsigned width_;                     /*!< Length of the k-mers */
+  std::vector<std::uint32_t> forward_; /*!< Counts on the forward strand */
+  std::vector<std::uint32_t> reverse_; /*!< Counts on the reverse strand */
+
+  // Count the k-mers of the records, encoded back to back
+  void count(const std::vector<const Sequence*>& records,
+             const std::vector<const Mask*>& masks, unsigned threads);
+  // Sum of the forward counts of the k-mers within tolerance of kmer
+  std::uint64_t neighbourhood(std::uint32_t kmer, unsigned tolerance) const;
+};
+
+}  // namespace dna
+}  // namespace ctga
+
+#endif  // CTGA_DNA_KMER_SPECTRUM_HPP_
+
+//
+// kmer_spectrum.hpp ends here
@@ -0,0 +1,194 @@
+// mask.cpp ---
+//
+// Filename: mask.cpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-02-19T08:40:12+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+#include "ctga/dna/mask.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <string>
+#include <vector>
+
+#include "ctga/dna/base.hpp"
+#include "ctga/dna/sequence.hpp"
+
+namespace ctga {
+namespace dna {
+
+void Mask::add(unsigned start, unsigned stop) {
+  if (start >= stop) return;
+
+  // Common case: intervals added in order
+  if (intervals_.empty() || start > intervals_.back().stop) {
+    intervals_.push_back(Interval{start, stop});
+    return;
+  }
+
+  // First interval that touches or follows the new one
+  auto first = std::lower_bound(intervals_.begin(), intervals_.end(), start,
+                                [](const Interval& it, unsigned pos) {
+                                  return it.stop < pos;
+                                });
+  auto last = first;
+  while (last != intervals_.end() && last->start <= stop) {
+    start = std::min(start, last->start);
+    stop = std::max(stop, last->stop);
+    ++last;
+  }
+  first = intervals_.erase(first, last);
+  intervals_.insert(first, Interval{start, stop});
+}
+
+void Mask::merge(const Mask& other) {
+  for (const auto& it : other.intervals_) add(it.start, it.stop);
+}
+
+Mask Mask::reverse(unsigned length) const {
+  Mask res{};
+  res.intervals_.reserve(intervals_.size());
+  for (auto it = intervals_.rbegin(); it != intervals_.rend(); ++it) {
+    if (it->start >= length) continue;
+    res.intervals_.push_back(
+        Interval{length - std::min(it->stop, length), length - it->start});
+  }
+  return res;
+}
+
+Mask Mask::slice(unsigned start, unsigned stop) const {
+  Mask res{};
+  auto it = std::lower_bound(intervals_.begin(), intervals_.end(), start,
+                             [](const Interval& i, unsigned pos) {
+                               return i.stop <= pos;
+                             });
+  for (; it != intervals_.end() && it->start < stop; ++it)
+    res.intervals_.push_back(Interval{std::max(it->start, start) - start,
+                                      std::min(it->stop, stop) - start});
+  return res;
+}
+
+unsigned Mask::masked() const {
+  unsigned res{};
+  for (const auto& it : intervals_) res += it.stop - it.start;
+  return res;
+}
+
+bool Mask::is_masked(unsigned pos) const {
+  auto it = std::upper_bound(intervals_.begin(), intervals_.end(), pos,
+                             [](unsigned p, const Interval& i) {
+                               return p < i.stop;
+                             });
+  return it != intervals_.end() && it->start <= pos;
+}
+
+Mask mask_ambiguous(const Sequence& seq, unsigned min_run) {
+  Mask res{};
+  unsigned start{}, run{};
+  for (auto i = 0U; i < seq.size(); ++i) {
+    if (nucleotides(seq[i]) & (nucleotides(seq[i]) - 1)) {
+      if (run++ == 0) start = i;
+    } else {
+      if (run >= min_run) res.add(start, i);
+      run = 0;
+    }
+  }
+  if (run > 0 && run >= min_run) res.add(start, seq.size());
+  return res;
+}
+
+Mask mask_soft(const std::string& str) {
+  Mask res{};
+  unsigned pos{}, start{};
+  bool in_run{false};
+  for (auto c : str) {
+    if (std::isspace(static_cast<unsigned char>(c))) continue;
+    bool lower = std::islower(static_cast<unsigned char>(c));
+    if (lower && !in_run) start = pos;
+    if (!lower && in_run) res.add(start, pos);
+    in_run = lower;
+    ++pos;
+  }
+  if (in_run) res.add(start, pos);
+  return res;
+}
+
+namespace {
+/** \brief Index of a pure base (A = 0, C = 1, G = 2, T = 3), 4 otherwise */
+inline unsigned code(Base b) {
+  return b <= Base::T ? static_cast<unsigned>(b) : 4;
+}
+}  // namespace
+
+Mask mask_dust(const Sequence& seq, unsigned window, double threshold) {
+  Mask res{};
+  if (window < 4 || seq.size() < window) return res;
+
+  // Triplet of each position (64 if it contains an ambiguous base)
+  auto triplet = [&seq](unsigned i) {
+    auto a = code(seq[i]), b = code(seq[i + 1]), c = code(seq[i + 2]);
+    return (a | b | c) & 4 ? 64U : (a << 4) | (b << 2) | c;
+  };
+
+  std::array<unsigned, 65> counts{};
+  // sum over the triplets of c_t * (c_t - 1) / 2, maintained incrementally
+  unsigned long sum{};
+  auto add = [&](unsigned t) { if (t < 64) sum += counts[t]++; };
+  auto remove = [&](unsigned t) { if (t < 64) sum -= --counts[t]; };
+
+  const auto ntriplets = window - 2;
+  for (auto i = 0U; i < ntriplets; ++i) add(triplet(i));
+
+  for (auto start = 0U; start + window <= seq.size(); ++start) {
+    if (start > 0) {
+      remove(triplet(start - 1));
+      add(triplet(start + ntriplets - 1));
+    }
+    if (static_cast<double>(sum) / (ntriplets - 1) > threshold)
+      res.add(start, start + window);
+  }
+  return res;
+}
+
+}  // namespace dna
+}  // namespace ctga
+
+//
+// mask.cpp ends here
@@ -0,0 +1,229 @@
+// mask.hpp ---
+//
+// Filename: mask.hpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-02-19T08:02:37+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+
+#ifndef CTGA_DNA_MASK_HPP_
+#define CTGA_DNA_MASK_HPP_
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "ctga/dna/sequence.hpp"
+
+namespace ctga {
+namespace dna {
+
+/** \brief Range [start, stop) of positions on a sequence */
+struct Interval {
+  unsigned start; /*!< First position (included) */
+  unsigned stop;  /*!< Last position (excluded) */
+};
+
+/**
+ *  \brief Set of masked regions of a sequence
+ *
+ *  The intervals are kept sorted and disjoint. Scanners use the mask to jump
+ *  over the masked regions (runs of N, soft-masked repeats, low complexity)
+ *  instead of scanning them.
+ */
+class Mask {
+ public:
+  /**
+   *  \brief Builds an empty mask
+   */
+  Mask() : intervals_{} {}
+
+  /**
+   *  \brief Mask a range of positions
+   *
+   *  \param start First position to mask (included)
+   *  \param stop Last position to mask (excluded)
+   */
+  void add(unsigned start, unsigned stop);
+
+  /**
+   *  \brief Mask all the positions masked by another mask
+   *
+   *  \param other Mask to merge into this one
+   */
+  void merge(const Mask& other);
+
+  /**
+   *  \brief Get the mask of the reverse (or reverse complement) sequence
+   *
+   *  \param length Length of the sequence
+   *  \return Mirrored mask
+   */
+  Mask reverse(unsigned length) const;
+
+  /**
+   *  \brief Get the mask of a subsequence
+   *
+   *  \param start First position of the subsequence (included)
+   *  \param stop Last position of the subsequence (excluded)
+   *  \return Mask of the subsequence, positions starting at 0
+   */
+  Mask slice(unsigned start, unsigned stop) const;
+
+  /**
+   *  \brief Get the masked intervals
+   *
+   *  \return Sorted, disjoint intervals
+   */
+  inline const std::vector<Interval>& intervals() const { return intervals_; }
+
+  /**
+   *  \brief Get the number of masked positions
+   *
+   *  \return Number of masked positions
+   */
+  unsigned masked() const;
+
+  /**
+   *  \brief Check if a position is masked
+   *
+   *  \param pos Position
+   *  \return True if the position is masked
+   */
+  bool is_masked(unsigned pos) const;
+
+  /**
+   *  \brief Go through the unmasked parts of a sequence
+   *
+   *  \param length Length of the sequence
+   *  \param f Function called as f(start, stop) for each unmasked segment
+   */
+  template <typename F>
+  void for_each_segment(unsigned length, F f) const {
+    unsigned pos{};
+    for (const auto& it : intervals_) {
+      if (it.start >= length) break;
+      if (it.start > pos) f(pos, it.start);
+      pos = std::max(pos, it.stop);
+    }
+    if (pos < length) f(pos, length);
+  }
+
+  /**
+   *  \brief Go through the unmasked parts of a range of positions
+   *
+   *  \param first First position of the range (included)
+   *  \param last Last position of the range (excluded)
+   *  \param f Function called as f(start, stop) for each unmasked segment
+   */
+  template <typename F>
+  void for_each_segment(unsigned first, unsigned last, F f) const {
+    auto it = std::lower_bound(intervals_.begin(), intervals_.end(), first,
+                               [](const Interval& i, unsigned pos) {
+                                 return i.stop <= pos;
+                               });
+    unsigned pos{first};
+    for (; it != intervals_.end() && it->start < last; ++it) {
+      if (it->start > pos) f(pos, it->start);
+      pos = std::max(pos, it->stop);
+    }
+    if (pos < last) f(pos, last);
+  }
+
+ private:
+  std::vector<Interval> intervals_; /*!< Sorted, disjoint intervals */
+};
+
+/**
+ *  \brief Mask the runs of ambiguous bases
+ *
+ *  \param seq Sequence to mask
+ *  \param min_run Minimum length of the runs to mask (1 masks every base
+ *  other than A, C, G and T)
+ *  \return Mask of the runs
+ */
+Mask mask_ambiguous(const Sequence& seq, unsigned min_run);
+
+/**
+ *  \brief Mask every base other than A, C, G and T
+ *
+ *  \param seq Sequence to mask
+ *  \return Mask of the ambiguous bases
+ */
+inline Mask mask_ambiguous(const Sequence& seq) {
+  return mask_ambiguous(seq, 1);
+}
+
+/**
+ *  \brief Mask the soft-masked (lowercase) regions of a raw sequence
+ *
+ *  \param str Sequence as read from the file
+ *  \return Mask of the lowercase runs
+ */
+Mask mask_soft(const std::string& str);
+
+/**
+ *  \brief Mask the low complexity regions of a sequence
+ *
+ *  DUST-like masking: a window is scored from the counts c_t of the triplets
+ *  it contains as sum(c_t * (c_t - 1) / 2) / (l - 1), l being the number of
+ *  triplets in the window. Windows scoring above the threshold are masked.
+ *
+ *  \param seq Sequence to mask
+ *  \param window Size of the window
+ *  \param threshold Maximum score of a window
+ *  \return Mask of the low complexity regions
+ */
+Mask mask_dust(const Sequence& seq, unsigned window, double threshold);
+
+/**
+ *  \brief Mask the low complexity regions of a sequence with the usual DUST
+ *  parameters (window of 64 bases, threshold of 20)
+ *
+ *  \param seq Sequence to mask
+ *  \return Mask of the low complexity regions
+ */
+inline Mask mask_dust(const Sequence& seq) { return mask_dust(seq, 64, 20.); }
+
+}  // namespace dna
+}  // namespace ctga
+
+#endif  // CTGA_DNA_MASK_HPP_
+
+//
+// mask.hpp ends here
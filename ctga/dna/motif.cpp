@@ -0,0 +1,69 @@
+// motif.cpp ---
+//
+// Filename: motif.cpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-02-12T09:37:02+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+#include "ctga/dna/motif.hpp"
+
+#include <iostream>
+#include <vector>
+
+#include "ctga/dna/base.hpp"
+
+namespace ctga {
+namespace dna {
+
+std::vector<Base> Motif::bases() const {
+  std::vector<Base> res{};
+  res.reserve(size_);
+  for (auto i = 0U; i < size_; ++i) res.push_back(operator[](i));
+  return res;
+}
+
+std::ostream& operator<<(std::ostream& os, const Motif& m) {
+  for (auto i = 0U; i < m.size(); ++i) os << m[i];
+  return os;
+}
+
+}  // namespace dna
+}  // namespace ctga
+
+//
+// motif.cpp ends here
@@ -0,0 +1,371 @@
+// motif.hpp ---
+//
+// Filename: motif.hpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-02-12T09:14:51+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+
+#ifndef CTGA_DNA_MOTIF_HPP_
+#define CTGA_DNA_MOTIF_HPP_
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "ctga/dna/base.hpp"
+
+namespace ctga {
+namespace dna {
+
+/**
+ *  \brief Short DNA motif packed into registers
+ *
+ *  A motif of at most 32 bases, stored as one nibble per position holding the
+ *  set of nucleotides the base stands for (@see nucleotides). Positions 0 to
+ *  15 are in the low word, 16 to 31 in the high word. All the operations are
+ *  done with bit tricks on the two words, so motifs can be passed by value,
+ *  hashed and compared without any allocation.
+ */
+class Motif {
+ public:
+  /** \brief Maximum number of bases in a motif */
+  static constexpr unsigned max_size = 32;
+
+  /**
+   *  \brief Builds an empty motif
+   */
+  constexpr Motif() : lo_{}, hi_{}, size_{} {}
+
+  /**
+   *  \brief Motif constructor
+   *
+   *  \param bases Bases of the motif (at most max_size)
+   */
+  explicit Motif(const std::vector<Base>& bases) : Motif{} {
+    if (bases.size() > max_size)
+      throw std::runtime_error{"Motif too long to be packed"};
+    for (auto b : bases) push_back(b);
+  }
+
+  /**
+   *  \brief Motif constructor
+   *
+   *  Builds a motif of pure nucleotides from its 2 bits codes
+   *  (A = 0, C = 1, G = 2, T = 3), the first base in the lowest bits.
+   *
+   *  \param codes Packed 2 bits codes
+   *  \param size Number of bases in the motif
+   */
+  constexpr Motif(std::uint64_t codes, unsigned size) : Motif{} {
+    for (auto i = 0U; i < size; ++i)
+      push_nibble(1U << ((codes >> (2 * i)) & 0x3));
+  }
+
+  /**
+   *  \brief Append a base at the end of the motif
+   *
+   *  \param b Base to append
+   */
+  constexpr void push_back(Base b) { push_nibble(nucleotides(b)); }
+
+  /**
+   *  \brief Slide the motif one base along a sequence
+   *
+   *  Drops the first base and appends a new one, keeping the size unchanged.
+   *  Used to pack the windows of a sequence on the fly.
+   *
+   *  \param b Base entering the window
+   */
+  constexpr void slide(Base b) {
+    lo_ = (lo_ >> 4) | (hi_ << 60);
+    hi_ >>= 4;
+    --size_;
+    push_back(b);
+  }
+
+  /**
+   *  \brief Get the number of bases in the motif
+   *
+   *  \return Number of bases
+   */
+  constexpr unsigned size() const { return size_; }
+
+  /**
+   *  \brief Get the set of nucleotides at a given position
+   *
+   *  \param i Position
+   *  \return Bitmask of the nucleotides (@see nucleotides)
+   */
+  constexpr unsigned nibble(unsigned i) const {
+    return static_cast<unsigned>(
+        (i < 16 ? lo_ >> (4 * i) : hi_ >> (4 * (i - 16))) & 0xF);
+  }
+
+  /**
+   *  \brief Get the base at a given position
+   *
+   *  \param i Position
+   *  \return Base at the position
+   */
+  constexpr Base operator[](unsigned i) const {
+    return nibble_bases[nibble(i)];
+  }
+
+  /**
+   *  \brief Check that the motif only contains A, C, G or T
+   *
+   *  \return True if no position is ambiguous
+   */
+  constexpr bool is_pure() const {
+    return single_nibbles(lo_, used(0)) && single_nibbles(hi_, used(16));
+  }
+
+  /**
+   *  \brief Get the 2 bits codes of the motif
+   *
+   *  Only meaningful for pure motifs (@see is_pure). The first base is in the
+   *  lowest bits, A = 0, C = 1, G = 2, T = 3, so that the codes of a motif
+   *  can directly be used as a k-mer index.
+   *
+   *  \return Packed codes
+   */
+  constexpr std::uint64_t codes() const {
+    return compact(lo_) | (compact(hi_) << 32);
+  }
+
+  /**
+   *  \brief Get the complement of the motif
+   *
+   *  \return Complement of the motif
+   */
+  constexpr Motif complement() const {
+    return Motif{complement_nibbles(lo_), complement_nibbles(hi_), size_};
+  }
+
+  /**
+   *  \brief Get the reverse of the motif
+   *
+   *  \return Reverse of the motif
+   */
+  constexpr Motif reverse() const {
+    // Reverse all 32 positions, then realign the first base on position 0
+    std::uint64_t lo = reverse_nibbles(hi_);
+    std::uint64_t hi = reverse_nibbles(lo_);
+    unsigned shift = 4 * (max_size - size_);
+    if (shift >= 64) {
+      lo = shift == 128 ? 0 : hi >> (shift - 64);
+      hi = 0;
+    } else if (shift > 0) {
+      lo = (lo >> shift) | (hi << (64 - shift));
+      hi >>= shift;
+    }
+    return Motif{lo, hi, size_};
+  }
+
+  /**
+   *  \brief Get the reverse complement of the motif
+   *
+   *  \return Reverse complement of the motif
+   */
+  constexpr Motif rev_complement() const { return reverse().complement(); }
+
+  /**
+   *  \brief Counts the number of incompatible positions between two motifs
+   *
+   *  \param other Motif of the same size
+   *  \return Number of differences
+   */
+  constexpr unsigned distance(const Motif& other) const {
+    return size_ - matches(lo_ & other.lo_) - matches(hi_ & other.hi_);
+  }
+
+  /**
+   *  \brief Mix two motifs
+   *
+   *  \param other Motif providing the end of the result
+   *  \param point Position from which the bases are taken from other
+   *  \return Motif made of the first point bases of this motif followed by the
+   *  bases of other
+   */
+  constexpr Motif splice(const Motif& other, unsigned point) const {
+    std::uint64_t lo_mask = point >= 16 ? ~0ULL : (1ULL << (4 * point)) - 1;
+    std::uint64_t hi_mask = point <= 16 ? 0ULL
+        : point >= 32 ? ~0ULL : (1ULL << (4 * (point - 16))) - 1;
+    return Motif{(lo_ & lo_mask) | (other.lo_ & ~lo_mask),
+          (hi_ & hi_mask) | (other.hi_ & ~hi_mask),
+          size_ > other.size_ ? size_ : other.size_};
+  }
+
+  /**
+   *  \brief Get the low word (positions 0 to 15)
+   */
+  constexpr std::uint64_t low() const { return lo_; }
+
+  /**
+   *  \brief Get the high word (positions 16 to 31)
+   */
+  constexpr std::uint64_t high() const { return hi_; }
+
+  /**
+   *  \brief Get the bases of the motif
+   *
+   *  \return Vector of bases
+   */
+  std::vector<Base> bases() const;
+
+  constexpr bool operator==(const Motif& other) const {
+    return size_ == other.size_ && lo_ == other.lo_ && hi_ == other.hi_;
+  }
+
+  constexpr bool operator!=(const Motif& other) const {
+    return !operator==(other);
+  }
+
+  constexpr bool operator<(const Motif& other) const {
+    return size_ != other.size_ ? size_ < other.size_
+        : hi_ != other.hi_ ? hi_ < other.hi_
+        : lo_ < other.lo_;
+  }
+
+  /**
+   *  \brief Hash of the motif
+   *
+   *  \return Hash value
+   */
+  constexpr std::size_t hash() const {
+    return static_cast<std::size_t>(
+        mix(lo_ ^ mix(hi_ ^ (static_cast<std::uint64_t>(size_) << 58))));
+  }
+
+  /** \brief Write a motif into a stream */
+  friend std::ostream& operator<<(std::ostream& os, const Motif& m);
+
+ private:
+  std::uint64_t lo_; /*!< Positions 0 to 15 */
+  std::uint64_t hi_; /*!< Positions 16 to 31 */
+  unsigned size_;    /*!< Number of bases */
+
+  static constexpr std::uint64_t ones = 0x1111111111111111ULL;
+
+  /** \brief Base matching each set of nucleotides (0 is never used) */
+  static constexpr Base nibble_bases[] = {
+    Base::N, Base::A, Base::C, Base::M, Base::G, Base::R, Base::S, Base::V,
+    Base::T, Base::W, Base::Y, Base::H, Base::K, Base::D, Base::B, Base::N};
+
+  constexpr Motif(std::uint64_t lo, std::uint64_t hi, unsigned size) :
+      lo_{lo}, hi_{hi}, size_{size} {}
+
+  constexpr void push_nibble(unsigned nibble) {
+    if (size_ < 16)
+      lo_ |= static_cast<std::uint64_t>(nibble) << (4 * size_);
+    else
+      hi_ |= static_cast<std::uint64_t>(nibble) << (4 * (size_ - 16));
+    ++size_;
+  }
+
+  /** \brief Mask of the nibbles in use in the word starting at position from */
+  constexpr std::uint64_t used(unsigned from) const {
+    return size_ <= from ? 0ULL
+        : size_ - from >= 16 ? ~0ULL : (1ULL << (4 * (size_ - from))) - 1;
+  }
+
+  /** \brief Number of non empty nibbles */
+  static constexpr unsigned matches(std::uint64_t x) {
+    return __builtin_popcountll((x | (x >> 1) | (x >> 2) | (x >> 3)) & ones);
+  }
+
+  /** \brief Check that every used nibble has exactly one bit set */
+  static constexpr bool single_nibbles(std::uint64_t x, std::uint64_t used) {
+    // Unused nibbles are set to 1 so that the subtraction never borrows
+    x = (x & used) | (ones & ~used);
+    return (x & (x - ones)) == 0 && matches(x) == 16;
+  }
+
+  /** \brief Mirror each nibble: A <-> T, C <-> G */
+  static constexpr std::uint64_t complement_nibbles(std::uint64_t x) {
+    x = ((x & 0x5555555555555555ULL) << 1) | ((x >> 1) & 0x5555555555555555ULL);
+    return ((x & 0x3333333333333333ULL) << 2)
+        | ((x >> 2) & 0x3333333333333333ULL);
+  }
+
+  /** \brief Reverse the order of the nibbles of a word */
+  static constexpr std::uint64_t reverse_nibbles(std::uint64_t x) {
+    x = ((x & 0x0F0F0F0F0F0F0F0FULL) << 4) | ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL);
+    x = ((x & 0x00FF00FF00FF00FFULL) << 8) | ((x >> 8) & 0x00FF00FF00FF00FFULL);
+    x = ((x & 0x0000FFFF0000FFFFULL) << 16)
+        | ((x >> 16) & 0x0000FFFF0000FFFFULL);
+    return (x << 32) | (x >> 32);
+  }
+
+  /** \brief Convert one-hot nibbles into 2 bits codes packed in 32 bits */
+  static constexpr std::uint64_t compact(std::uint64_t x) {
+    // Bit 0 of the code is set for C and T, bit 1 for G and T
+    std::uint64_t v = (((x >> 1) | (x >> 3)) & ones)
+        | ((((x >> 2) | (x >> 3)) & ones) << 1);
+    v = (v | (v >> 2)) & 0x0F0F0F0F0F0F0F0FULL;
+    v = (v | (v >> 4)) & 0x00FF00FF00FF00FFULL;
+    v = (v | (v >> 8)) & 0x0000FFFF0000FFFFULL;
+    return (v | (v >> 16)) & 0x00000000FFFFFFFFULL;
+  }
+
+  /** \brief Finaliser of splitmix64 */
+  static constexpr std::uint64_t mix(std::uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+  }
+};
+
+}  // namespace dna
+}  // namespace ctga
+
+namespace std {
+/** \brief Hash of a motif, to use them as keys of unordered containers */
+template <>
+struct hash<ctga::dna::Motif> {
+  std::size_t operator()(const ctga::dna::Motif& m) const { return m.hash(); }
+};
+}  // namespace std
+
+#endif  // CTGA_DNA_MOTIF_HPP_
+
+//
+// motif.hpp ends here
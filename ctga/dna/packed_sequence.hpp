@@ -0,0 +1,264 @@
+// packed_sequence.hpp ---
+//
+// Filename: packed_sequence.hpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-12T14:02:55+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+
+#ifndef CTGA_DNA_PACKED_SEQUENCE_HPP_
+#define CTGA_DNA_PACKED_SEQUENCE_HPP_
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "ctga/dna/alphabet.hpp"
+#include "ctga/dna/sequence.hpp"
+
+namespace ctga {
+namespace dna {
+
+/**
+ *  \brief Sequence stored as packed codes of an alphabet
+ *
+ *  Codes take Alphabet::bits bits each, so a 64 bits word holds 32 pure DNA
+ *  bases, 16 IUPAC symbols or 12 amino acids. Windows of up to that many
+ *  symbols are compared to a motif with a few word operations, the width of
+ *  the codes being known at compile time.
+ *
+ *  \tparam Alphabet Alphabet policy (@see DNA4)
+ */
+template <typename Alphabet>
+class PackedSequence {
+ public:
+  /** \brief Width of a code */
+  static constexpr unsigned bits = Alphabet::bits;
+  /** \brief Number of codes in a word, and maximum width of a motif */
+  static constexpr unsigned per_word = 64 / bits;
+
+  /**
+   *  \brief Builds an empty sequence
+   */
+  PackedSequence() : words_{}, size_{} {}
+
+  /**
+   *  \brief Builds a packed sequence from its symbols
+   *
+   *  \param str Symbols of the alphabet
+   */
+  explicit PackedSequence(const std::string& str) : PackedSequence{} {
+    words_.reserve(str.size() / per_word + 1);
+    for (auto c : str) {
+      auto code = Alphabet::code(c);
+      if (code < 0)
+        throw std::runtime_error{"Symbol outside of the alphabet"};
+      push_back(code);
+    }
+  }
+
+  /**
+   *  \brief Builds a packed sequence from a DNA sequence
+   *
+   *  Bases outside of the alphabet (the ambiguous bases for DNA4) are stored
+   *  with code 0: mask them (@see mask_ambiguous) before scanning.
+   *
+   *  \param seq DNA sequence
+   */
+  template <typename A = Alphabet,
+            typename = typename std::enable_if<A::nucleic>::type>
+  explicit PackedSequence(const Sequence& seq) : PackedSequence{} {
+    words_.reserve(seq.size() / per_word + 1);
+    for (auto i = 0U; i < seq.size(); ++i) {
+      auto code = Alphabet::code(seq[i]);
+      push_back(code < 0 ? 0 : code);
+    }
+  }
+
+  /**
+   *  \brief Append a code at the end of the sequence
+   *
+   *  \param code Code of the symbol
+   */
+  inline void push_back(unsigned code) {
+    if (size_ % per_word == 0) words_.push_back(0);
+    words_.back() |= static_cast<std::uint64_t>(code)
+                     << (bits * (size_ % per_word));
+    ++size_;
+  }
+
+  /**
+   *  \brief Get the number of symbols in the sequence
+   *
+   *  \return Number of symbols
+   */
+  inline unsigned size() const { return size_; }
+
+  /**
+   *  \brief Get the code at a given position
+   *
+   *  \param i Position
+   *  \return Code of the symbol
+   */
+  inline unsigned operator[](unsigned i) const {
+    return (words_[i / per_word] >> (bits * (i % per_word))) & code_mask;
+  }
+
+  /**
+   *  \brief Get a window packed into a word
+   *
+   *  \param pos Position of the first symbol, stored in the lowest bits
+   *  \param width Number of symbols (at most per_word)
+   *  \return Packed window
+   */
+  inline std::uint64_t window(unsigned pos, unsigned width) const {
+    std::uint64_t res{};
+    for (auto i = 0U; i < width; ++i)
+      res |= static_cast<std::uint64_t>(operator[](pos + i)) << (bits * i);
+    return res;
+  }
+
+  /**
+   *  \brief Count the mismatches between two packed windows
+   *
+   *  \param a First window
+   *  \param b Second window
+   *  \param width Number of symbols in the windows
+   *  \return Number of positions where the codes don't match
+   */
+  static inline unsigned mismatches(std::uint64_t a, std::uint64_t b,
+                                    unsigned width) {
+    auto lanes = lane_starts & used(width);
+    if (Alphabet::sets)
+      return width - __builtin_popcountll(fold(a & b) & lanes);
+    return __builtin_popcountll(fold(a ^ b) & lanes);
+  }
+
+  /**
+   *  \brief Go through the packed windows of a given width
+   *
+   *  \param width Width of the windows (at most per_word)
+   *  \param first First window start (included)
+   *  \param last Last window start (excluded)
+   *  \param f Function called as f(pos, window) for each window
+   */
+  template <typename F>
+  void for_each_window(unsigned width, unsigned first, unsigned last,
+                       F f) const {
+    if (first >= last || width == 0) return;
+    auto w = window(first, width);
+    const auto top = bits * (width - 1);
+    for (auto i = first; i < last; ++i) {
+      if (i > first)
+        w = (w >> bits) | (static_cast<std::uint64_t>(
+            operator[](i + width - 1)) << top);
+      f(i, w);
+    }
+  }
+
+  /**
+   *  \brief Go through the windows similar to a motif
+   *
+   *  \param motif Packed motif, first symbol in the lowest bits
+   *  \param width Width of the motif (at most per_word)
+   *  \param tolerance Number of mismatches allowed
+   *  \param first First window start to test (included)
+   *  \param last Last window start to test (excluded)
+   *  \param f Function called as f(pos) for each similar window
+   */
+  template <typename F>
+  void scan(std::uint64_t motif, unsigned width, unsigned tolerance,
+            unsigned first, unsigned last, F f) const {
+    for_each_window(width, first, last, [&](unsigned i, std::uint64_t w) {
+        if (mismatches(w, motif, width) <= tolerance) f(i);
+      });
+  }
+
+  /**
+   *  \brief Given a motif, finds all positions where a similar one is found
+   *
+   *  \param motif Motif, of at most per_word symbols
+   *  \param tolerance Number of mismatches allowed
+   *  \return Positions of the similar windows
+   */
+  std::vector<unsigned> find_similar(const PackedSequence& motif,
+                                     unsigned tolerance) const {
+    if (motif.size() > per_word)
+      throw std::runtime_error{"Motif too long to be packed"};
+    std::vector<unsigned> res{};
+    auto last = size_ > motif.size() ? size_ - motif.size() : 0U;
+    scan(motif.window(0, motif.size()), motif.size(), tolerance, 0, last,
+         [&res](unsigned i) { res.push_back(i); });
+    return res;
+  }
+
+ private:
+  static constexpr std::uint64_t code_mask = (1ULL << bits) - 1;
+
+  /** \brief Lowest bit of each code of a word */
+  static constexpr std::uint64_t lane_starts = [] {
+    std::uint64_t res{};
+    for (auto i = 0U; i < per_word; ++i) res |= 1ULL << (bits * i);
+    return res;
+  }();
+
+  std::vector<std::uint64_t> words_; /*!< Packed codes */
+  unsigned size_;                    /*!< Number of symbols */
+
+  /** \brief Mask of the bits used by a window of a given width */
+  static constexpr std::uint64_t used(unsigned width) {
+    return bits * width >= 64 ? ~0ULL : (1ULL << (bits * width)) - 1;
+  }
+
+  /** \brief Gather on the lowest bit of each code whether it is non zero */
+  static constexpr std::uint64_t fold(std::uint64_t x) {
+    std::uint64_t res{x};
+    for (auto k = 1U; k < bits; ++k) res |= x >> k;
+    return res;
+  }
+};
+
+}  // namespace dna
+}  // namespace ctga
+
+#endif  // CTGA_DNA_PACKED_SEQUENCE_HPP_
+
+//
+// packed_sequence.hpp ends here
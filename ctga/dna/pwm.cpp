@@ -42,31 +42,45 @@
 
 #include "ctga/dna/pwm.hpp"
 
+#include <algorithm>
+#include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <future>
+#include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
 #include <vector>
 
+#include "ctga/dna/alphabet.hpp"
 #include "ctga/dna/base.hpp"
+#include "ctga/dna/packed_sequence.hpp"
 #include "ctga/dna/sequence.hpp"
 #include "ctga/tools/statistics.hpp"
+#include "ctga/tools/thread_pool.hpp"
 
 namespace ctga {
 namespace dna {
 
 PWM::PWM(const Eigen::VectorXd& probas,
          const std::map<Base, double>& frequencies) :
-    values_{Eigen::MatrixXd(4, probas.rows() / 4)} {
-  Eigen::VectorXd f(4);
-
-  for (auto i = 0U; i < probas.size(); i += 4) {
-    auto norm_col = tools::statistics::normalise(probas.segment(i, 4), 0.001);
-    values_.col(i / 4) = norm_col;
+    values_{Eigen::MatrixXd(4, probas.rows() / 4)},
+    background_{{frequencies.at(Base::A), frequencies.at(Base::C),
+                 frequencies.at(Base::G), frequencies.at(Base::T)}},
+    distribution_{std::make_shared<DistributionCache>()} {
+  // Normalised column by column on the stack, as FixedPWM does, so that
+  // both give the same values
+  Eigen::Matrix<double, 4, 1> column{};
+  for (auto col = 0U; col < values_.cols(); ++col) {
+    column = probas.segment<4>(4 * col);
+    tools::statistics::normalise_inplace(column, 0.001);
+    for (auto b = 0U; b < 4; ++b)
+      values_(b, col) = std::log2(column[b] / background_[b]);
   }
-  values_.row(0) = values_.row(0) / frequencies.at(Base::A);
-  values_.row(1) = values_.row(1) / frequencies.at(Base::C);
-  values_.row(2) = values_.row(2) / frequencies.at(Base::G);
-  values_.row(3) = values_.row(3) / frequencies.at(Base::T);
-  values_ = values_.unaryExpr([](double x) { return std::log2(x); });
+  build_blocks();
+  build_bounds();
 }
 
 double PWM::score(const Sequence &sequence) const {
@@ -78,13 +92,77 @@ double PWM::score(const Sequence &sequence) const {
   return res;
 }
 
+double PWM::score(const Sequence& sequence, unsigned pos) const {
+  double res{};
+
+  for (auto i = 0U; i < size(); ++i)
+    res += score(i, sequence[pos + i]);
+
+  return res;
+}
+
+const ScoreDistribution& PWM::distribution() const {
+  std::call_once(distribution_->once, [this] {
+      distribution_->distribution.reset(
+          new ScoreDistribution{values_, background_});
+    });
+  return *distribution_->distribution;
+}
+
+double PWM::score(std::uint64_t window) const {
+  assert(size() <= PackedSequence<DNA4>::per_word);
+  constexpr unsigned entries = 1U << (2 * block_size);
+  double res{};
+  for (auto b = 0U; b * block_size < size(); ++b) {
+    res += blocks_[b * entries + (window & (entries - 1))];
+    window >>= 2 * block_size;
+  }
+  return res;
+}
+
 std::vector<Sequence> PWM::find_matches(const Sequence& sequence) const {
+  // Ambiguous bases can't be scored
+  auto ambiguous = mask_ambiguous(sequence);
+  if (!ambiguous.intervals().empty()
+      && ambiguous.intervals().front().start + 1 < sequence.size())
+    throw std::runtime_error{"Can't score this…"};
+  return find_matches(sequence, ambiguous);
+}
+
+std::vector<Sequence> PWM::find_matches(const Sequence& sequence,
+                                        const Mask& mask) const {
+  return find_matches(sequence, mask, 0.);
+}
+
+std::vector<Sequence> PWM::find_matches(const Sequence& sequence,
+                                        const Mask& mask,
+                                        double threshold) const {
   std::vector<Sequence> res{};
+  auto last = sequence.size() > size() ? sequence.size() - size() : 0U;
+  if (size() == 0 || max_score() <= threshold) return res;
+  auto skip = mask_ambiguous(sequence);
+  skip.merge(mask);
+  double s{};
 
-  for (auto i = 0U; i < sequence.size() - size(); ++i) {
-    auto sub = sequence.subsequence(i, i + size());
-    if (score(sub) > 0.) res.push_back(sub);
+  if (size() > PackedSequence<DNA4>::per_word) {
+    skip.for_each_segment(sequence.size(), [&](unsigned start, unsigned stop) {
+        for (auto i = start; i + size() <= stop && i < last; ++i)
+          if (score_above(sequence, i, threshold, &s))
+            res.push_back(sequence.subsequence(i, i + size()));
+      });
+    return res;
   }
+
+  PackedSequence<DNA4> codes{sequence};
+  skip.for_each_segment(sequence.size(), [&](unsigned start, unsigned stop) {
+      if (stop - start < size()) return;
+      auto end = std::min(stop - size() + 1, last);
+      codes.for_each_window(size(), start, end,
+                            [&](unsigned i, std::uint64_t window) {
+          if (score_above(window, threshold, &s))
+            res.push_back(sequence.subsequence(i, i + size()));
+        });
+    });
   return res;
 }
 
@@ -120,6 +198,162 @@ double PWM::score(unsigned col, Base b) const {
   return res;
 }
 
+std::vector<Site> PWM::find_best(const Sequence& sequence, const Mask& mask,
+                                 unsigned k, unsigned threads) const {
+  auto last = sequence.size() > size() ? sequence.size() - size() : 0U;
+  if (k == 0 || size() == 0 || last == 0) return {};
+
+  auto skip = mask_ambiguous(sequence);
+  skip.merge(mask);
+  auto rev = sequence.rev_complement();
+  auto rev_skip = skip.reverse(sequence.size());
+  std::unique_ptr<PackedSequence<DNA4>> codes{}, rev_codes{};
+  if (size() <= PackedSequence<DNA4>::per_word) {
+    codes.reset(new PackedSequence<DNA4>{sequence});
+    rev_codes.reset(new PackedSequence<DNA4>{rev});
+  }
+
+  std::atomic<double> shared{-std::numeric_limits<double>::infinity()};
+  auto chunks = std::max(1U, std::min(threads, last));
+  auto scan_chunk = [&](unsigned c) {
+    TopK best{k};
+    auto first = static_cast<unsigned>(std::uint64_t{last} * c / chunks);
+    auto stop = static_cast<unsigned>(std::uint64_t{last} * (c + 1) / chunks);
+    scan_best(sequence, codes.get(), skip, first, stop, false, &best, &shared);
+    scan_best(rev, rev_codes.get(), rev_skip, first, stop, true, &best,
+              &shared);
+    return best;
+  };
+
+  if (chunks == 1) return scan_chunk(0).sorted();
+
+  // Every task refers to the locals: wait for all of them before any error
+  auto pool = tools::ThreadPool::get();
+  std::vector<std::future<TopK>> futures{};
+  for (auto c = 0U; c < chunks; ++c)
+    futures.push_back(pool->submit([&scan_chunk, c] {
+          return scan_chunk(c);
+        }));
+  for (auto& f : futures) f.wait();
+  TopK res{k};
+  for (auto& f : futures) res.merge(f.get());
+  return res.sorted();
+}
+
+void PWM::scan_best(const Sequence& strand, const PackedSequence<DNA4>* codes,
+                    const Mask& skip, unsigned first, unsigned last,
+                    bool reverse, TopK* best,
+                    std::atomic<double>* shared) const {
+  const auto lowest = -std::numeric_limits<double>::infinity();
+  auto n = strand.size();
+  auto offer = [&](unsigned i, double score) {
+    // Sites of the reverse strand are given on the forward one
+    if (!best->push(Site{reverse ? n - size() - i : i, reverse, score}))
+      return;
+    auto t = best->threshold();
+    auto current = shared->load();
+    while (t > current && !shared->compare_exchange_weak(current, t)) {}
+  };
+  // Windows scoring as much as the k-th site may still be better (@see
+  // better): only those strictly below it are abandoned
+  auto limit = [&] {
+    auto t = std::max(best->threshold(), shared->load());
+    return t == lowest ? t : std::nextafter(t, lowest);
+  };
+
+  double score{};
+  skip.for_each_segment(first, last + size() - 1,
+                        [&](unsigned start, unsigned stop) {
+      if (stop - start < size()) return;
+      auto end = std::min(stop - size() + 1, last);
+      if (codes == nullptr) {
+        for (auto i = start; i < end; ++i)
+          if (score_above(strand, i, limit(), &score)) offer(i, score);
+        return;
+      }
+      codes->for_each_window(size(), start, end,
+                             [&](unsigned i, std::uint64_t window) {
+          if (score_above(window, limit(), &score)) offer(i, score);
+        });
+    });
+}
+
+void PWM::build_blocks() {
+  constexpr unsigned entries = 1U << (2 * block_size);
+  auto n_blocks = (size() + block_size - 1) / block_size;
+  blocks_.assign(n_blocks * entries, 0.);
+
+  for (auto b = 0U; b < n_blocks; ++b) {
+    auto columns = std::min(block_size, size() - b * block_size);
+    for (auto kmer = 0U; kmer < 1U << (2 * columns); ++kmer)
+      for (auto j = 0U; j < columns; ++j)
+        blocks_[b * entries + kmer] +=
+            values_((kmer >> (2 * j)) & 3, b * block_size + j);
+  }
+}
+
+void PWM::build_bounds() {
+  constexpr unsigned entries = 1U << (2 * block_size);
+  // The information of a column (or block) is the gap between its best and
+  // its mean value: the expected loss against the bound on random windows
+  auto by_gap = [](std::vector<unsigned>* order, std::vector<double>* bound,
+                   const std::vector<double>& best,
+                   const std::vector<double>& mean) {
+    order->resize(best.size());
+    std::iota(order->begin(), order->end(), 0U);
+    std::stable_sort(order->begin(), order->end(), [&](unsigned a, unsigned b) {
+        return best[a] - mean[a] > best[b] - mean[b];
+      });
+    bound->assign(best.size() + 1, 0.);
+    for (auto i = best.size(); i > 0; --i)
+      (*bound)[i - 1] = (*bound)[i] + best[(*order)[i - 1]];
+  };
+
+  std::vector<double> best(size()), mean(size());
+  for (auto col = 0U; col < size(); ++col) {
+    best[col] = values_.col(col).maxCoeff();
+    mean[col] = values_.col(col).mean();
+  }
+  by_gap(&column_order_, &column_bound_, best, mean);
+
+  auto n_blocks = blocks_.size() / entries;
+  best.assign(n_blocks, 0.);
+  mean.assign(n_blocks, 0.);
+  for (auto b = 0U; b < n_blocks; ++b)
+    for (auto j = b * block_size; j < std::min((b + 1) * block_size, size());
+         ++j) {
+      best[b] += values_.col(j).maxCoeff();
+      mean[b] += values_.col(j).mean();
+    }
+  by_gap(&block_order_, &block_bound_, best, mean);
+}
+
+bool PWM::score_above(const Sequence& sequence, unsigned pos,
+                      double threshold, double* score) const {
+  double res{};
+  for (auto i = 0U; i < column_order_.size(); ++i) {
+    if (res + column_bound_[i] <= threshold) return false;
+    auto col = column_order_[i];
+    res += values_(static_cast<unsigned>(sequence[pos + col]), col);
+  }
+  *score = res;
+  return res > threshold;
+}
+
+bool PWM::score_above(std::uint64_t window, double threshold,
+                      double* score) const {
+  constexpr unsigned entries = 1U << (2 * block_size);
+  double res{};
+  for (auto i = 0U; i < block_order_.size(); ++i) {
+    if (res + block_bound_[i] <= threshold) return false;
+    auto b = block_order_[i];
+    res += blocks_[b * entries
+                   + ((window >> (2 * block_size * b)) & (entries - 1))];
+  }
+  *score = res;
+  return res > threshold;
+}
+
 }  // namespace dna
 }  // namespace ctga
 
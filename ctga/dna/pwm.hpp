@@ -45,17 +45,30 @@
 
 
 #include <eigen3/Eigen/Core>
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include "ctga/dna/base.hpp"
+#include "ctga/dna/mask.hpp"
+#include "ctga/dna/alphabet.hpp"
+#include "ctga/dna/packed_sequence.hpp"
+#include "ctga/dna/score_distribution.hpp"
 #include "ctga/dna/sequence.hpp"
+#include "ctga/dna/top_k.hpp"
 
 namespace ctga {
 namespace dna {
 
 class PWM {
  public:
+  /** \brief Number of columns combined in a lookup of the k-mer tables */
+  static constexpr unsigned block_size = 4;
+
   explicit PWM(const Eigen::VectorXd& probas)  :
       PWM{probas, std::map<Base, double>{
       {Base::A, 0.25},
@@ -67,8 +80,69 @@ class PWM {
 
   double score(const Sequence& sequence) const;
 
+  /**
+   *  \brief Score the window of a sequence starting at a given position
+   *
+   *  \param sequence Sequence containing the window
+   *  \param pos Position of the first base of the window
+   *  \return Score of the window
+   */
+  double score(const Sequence& sequence, unsigned pos) const;
+
+  /**
+   *  \brief Score a window packed on 2 bits
+   *
+   *  The columns are scored by blocks of block_size, each block taking a
+   *  single lookup in a table holding the partial score of every k-mer.
+   *
+   *  \param window Bases of the window on 2 bits, the first one in the lowest
+   *  bits and the bits above the window cleared (@see PackedSequence)
+   *  \return Score of the window
+   */
+  double score(std::uint64_t window) const;
+
   inline double norm() const { return values_.norm(); }
 
+  /**
+   *  \brief Get the best score a window can reach
+   *
+   *  \return Sum of the best value of each column
+   */
+  inline double max_score() const { return column_bound_.front(); }
+
+  /**
+   *  \brief Get the distribution of the scores under the background
+   *
+   *  It is computed on the first call, and shared by the copies of the PWM.
+   *
+   *  \return Score distribution
+   */
+  const ScoreDistribution& distribution() const;
+
+  /**
+   *  \brief Get the probability for a window drawn from the background to
+   *  score at least a given score
+   *
+   *  \param score Score
+   *  \return P-value of the score
+   */
+  inline double p_value(double score) const {
+    return distribution().p_value(score);
+  }
+
+  /**
+   *  \brief Get the threshold matching a p-value
+   *
+   *  Windows scoring strictly above it are drawn from the background with a
+   *  probability of at most p_value (@see ScoreDistribution).
+   *
+   *  \param p_value Probability
+   *  \return Threshold
+   */
+  inline double threshold(double p_value) const {
+    return distribution().threshold(p_value);
+  }
+
   /**
    *  \brief Find subsequences matching the PWM
    *
@@ -77,20 +151,126 @@ class PWM {
    */
   std::vector<Sequence> find_matches(const Sequence& sequence) const;
 
+  /**
+   *  \brief Find subsequences matching the PWM outside of the masked regions
+   *
+   *  Windows overlapping a masked region or an ambiguous base are not
+   *  scored. PWMs of up to 32 columns score the packed sequence with the
+   *  k-mer tables.
+   *
+   *  \param sequence Sequence to scan
+   *  \param mask Regions of the sequence to skip
+   *  \return List of sequences matcing the PWM
+   */
+  std::vector<Sequence> find_matches(const Sequence& sequence,
+                                     const Mask& mask) const;
+
+  /**
+   *  \brief Find subsequences scoring above a threshold outside of the masked
+   *  regions
+   *
+   *  Columns (or blocks of columns for the k-mer tables) are scored from the
+   *  most to the least informative one, and a window is abandoned as soon as
+   *  its partial score plus the best score of the remaining columns can't
+   *  exceed the threshold: the more stringent the threshold, the fewer
+   *  columns are read.
+   *
+   *  \param sequence Sequence to scan
+   *  \param mask Regions of the sequence to skip
+   *  \param threshold Windows must score strictly above it
+   *  \return List of sequences scoring above the threshold
+   */
+  std::vector<Sequence> find_matches(const Sequence& sequence,
+                                     const Mask& mask,
+                                     double threshold) const;
+
+  /**
+   *  \brief Find the best sites of the PWM on both strands
+   *
+   *  The score of the k-th best site found so far is used as the threshold
+   *  of the scan (@see find_matches), so that most windows are abandoned
+   *  after a few columns once good sites are known. The windows are split
+   *  in chunks scanned in parallel, each keeping its own best sites; the
+   *  chunks share the highest of their thresholds, and their sites are
+   *  merged at the end. The result doesn't depend on the number of chunks.
+   *  Several chunks run as tasks of the shared thread pool (@see
+   *  tools::ThreadPool::get), so they must not be requested from one of its
+   *  tasks.
+   *
+   *  \param sequence Sequence to scan
+   *  \param mask Regions of the sequence to skip, the ambiguous bases being
+   *  always skipped
+   *  \param k Number of sites to find
+   *  \param threads Number of chunks scanned on the thread pool
+   *  \return Best sites, best first
+   */
+  std::vector<Site> find_best(const Sequence& sequence, const Mask& mask,
+                              unsigned k, unsigned threads) const;
+
+  /**
+   *  \brief Find the best sites of the PWM on both strands
+   *
+   *  \param sequence Sequence to scan
+   *  \param k Number of sites to find
+   *  \return Best sites, best first
+   */
+  inline std::vector<Site> find_best(const Sequence& sequence,
+                                     unsigned k) const {
+    return find_best(sequence, Mask{}, k, 1);
+  }
+
   Eigen::MatrixXd to_proba() const;
 
   Sequence consensus() const;
 
   inline unsigned size() const { return values_.cols(); }
 
+  /**
+   *  \brief Get the log-odds values
+   *
+   *  \return Matrix with a row per base (A, C, G, T) and a column per
+   *  position
+   */
+  inline const Eigen::MatrixXd& values() const { return values_; }
+
   friend std::ostream& operator<<(std::ostream& os, const PWM& c) {
     os << c.values_;
     return os;
   }
 
  private:
+  /** \brief Score distribution, computed once for all the copies */
+  struct DistributionCache {
+    std::once_flag once;
+    std::unique_ptr<ScoreDistribution> distribution;
+  };
+
   Eigen::MatrixXd values_;
+  std::array<double, 4> background_; /*!< Frequencies of A, C, G and T */
+  std::shared_ptr<DistributionCache> distribution_;
+  std::vector<double> blocks_; /*!< Partial score of each k-mer of a block of
+                                  columns, 4^block_size entries per block */
+  std::vector<unsigned> column_order_; /*!< Columns by decreasing information */
+  std::vector<double> column_bound_;   /*!< Best score of the columns from
+                                          column_order_[i] on */
+  std::vector<unsigned> block_order_;  /*!< Blocks by decreasing information */
+  std::vector<double> block_bound_;    /*!< Best score of the blocks from
+                                          block_order_[i] on */
   double score(unsigned col, Base b) const;
+  void build_blocks();
+  void build_bounds();
+
+  // Score a window, abandoning it once the threshold is out of reach
+  bool score_above(const Sequence& sequence, unsigned pos, double threshold,
+                   double* score) const;
+  bool score_above(std::uint64_t window, double threshold,
+                   double* score) const;
+
+  // Offer the windows [first, last) of a strand to the best sites, codes
+  // being the packed strand for PWMs of up to 32 columns, nullptr otherwise
+  void scan_best(const Sequence& strand, const PackedSequence<DNA4>* codes,
+                 const Mask& skip, unsigned first, unsigned last, bool reverse,
+                 TopK* best, std::atomic<double>* shared) const;
 };
 
 
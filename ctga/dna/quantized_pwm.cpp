@@ -0,0 +1,320 @@
+// quantized_pwm.cpp ---
+//
+// Filename: quantized_pwm.cpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-14T10:12:43+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+#include "ctga/dna/quantized_pwm.hpp"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "ctga/dna/alphabet.hpp"
+
+namespace ctga {
+namespace dna {
+
+namespace {
+/** \brief Largest absolute quantized score of a valid window */
+constexpr double max_score = -double{QuantizedPWM::lowest};
+/** \brief Entries of the k-mer table of a block of columns */
+constexpr unsigned block_entries = 1U << (2 * PWM::block_size);
+/** \brief Widest window packed in a word */
+constexpr unsigned max_packed = 32;
+/** \brief Quantized value of the invalid codes */
+constexpr std::int16_t invalid_value = std::numeric_limits<std::int16_t>::min();
+}  // namespace
+
+CodedSequence::CodedSequence(const Sequence& seq, const Mask& mask) :
+    codes_(seq.size(), invalid) {
+  mask.for_each_segment(seq.size(), [&](unsigned start, unsigned stop) {
+      for (auto i = start; i < stop; ++i) {
+        auto code = DNA4::code(seq[i]);
+        if (code >= 0) codes_[i] = code;
+      }
+    });
+}
+
+QuantizedPWM::QuantizedPWM(const PWM& pwm) : QuantizedPWM{pwm.values()} {}
+
+QuantizedPWM::QuantizedPWM(const Eigen::Ref<const Eigen::MatrixXd>& values) :
+    size_{static_cast<unsigned>(values.cols())}, scale_{1.},
+    values_(codes * values.cols(), invalid_value),
+    low_{}, high_{}, blocks_{} {
+  double bound{};
+  for (auto col = 0U; col < size_; ++col)
+    bound += values.col(col).cwiseAbs().maxCoeff();
+  // Rounding adds up to half a unit per column: valid windows stay within
+  // max_score
+  if (bound > 0.) scale_ = (max_score - 0.5 * size_) / bound;
+
+  for (auto col = 0U; col < size_; ++col)
+    for (auto b = 0U; b < 4; ++b)
+      values_[col * codes + b] = std::lround(values(b, col) * scale_);
+  build_tables();
+}
+
+QuantizedPWM QuantizedPWM::rev_complement() const {
+  QuantizedPWM res{};
+  res.size_ = size_;
+  res.scale_ = scale_;
+  res.values_.assign(values_.size(), invalid_value);
+  for (auto col = 0U; col < size_; ++col)
+    for (auto b = 0U; b < 4; ++b)
+      res.values_[(size_ - 1 - col) * codes + 3 - b] =
+          values_[col * codes + b];
+  res.build_tables();
+  return res;
+}
+
+void QuantizedPWM::build_tables() {
+  low_.clear();
+  high_.clear();
+  low_.reserve(values_.size());
+  high_.reserve(values_.size());
+  for (auto v : values_) {
+    auto bits = static_cast<std::uint16_t>(v);
+    low_.push_back(bits & 0xFF);
+    high_.push_back(bits >> 8);
+  }
+
+  // Sums of the rounded values, so that both scans give the same scores
+  auto n_blocks = (size_ + PWM::block_size - 1) / PWM::block_size;
+  blocks_.assign(n_blocks * block_entries, 0);
+  for (auto b = 0U; b < n_blocks; ++b) {
+    auto columns = std::min(PWM::block_size, size_ - b * PWM::block_size);
+    for (auto kmer = 0U; kmer < 1U << (2 * columns); ++kmer)
+      for (auto j = 0U; j < columns; ++j) {
+        auto col = b * PWM::block_size + j;
+        blocks_[b * block_entries + kmer] +=
+            values_[col * codes + ((kmer >> (2 * j)) & 3)];
+      }
+  }
+}
+
+double QuantizedPWM::score(const CodedSequence& seq, unsigned pos) const {
+  int res{};
+  for (auto col = 0U; col < size_; ++col)
+    res += values_[col * codes + seq.data()[pos + col]];
+  return std::max(res, int{invalid_value}) / scale_;
+}
+
+ScanSummary QuantizedPWM::scan(const CodedSequence& seq,
+                               double threshold) const {
+  auto last = seq.size() > size_ ? seq.size() - size_ : 0U;
+  auto limit = quantize(threshold);
+  const auto* codes_ptr = seq.data();
+  unsigned hits{};
+  std::int64_t sum{};
+  auto i = 0U;
+
+#ifdef __AVX2__
+  // Windows i to i + 31 are scored together: each column adds, for each
+  // window, the entry of its table at the code of the window's base
+  const __m256i threshold_v = _mm256_set1_epi16(limit);
+  const __m256i ones = _mm256_set1_epi16(1);
+  __m256i sums = _mm256_setzero_si256();
+  unsigned pending{};
+  auto flush = [&] {
+    alignas(32) std::int32_t lanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), sums);
+    for (auto l : lanes) sum += l;
+    sums = _mm256_setzero_si256();
+    pending = 0;
+  };
+  auto accumulate = [&](__m256i scores) {
+    auto above = _mm256_cmpgt_epi16(scores, threshold_v);
+    // Two bits of the byte mask per 16 bits lane
+    hits += __builtin_popcount(_mm256_movemask_epi8(above)) / 2;
+    sums = _mm256_add_epi32(
+        sums, _mm256_madd_epi16(_mm256_and_si256(scores, above), ones));
+  };
+
+  for (; i + 32 <= last; i += 32) {
+    // Bytes 0-7 and 16-23 of the codes land in first, 8-15 and 24-31 in
+    // second: the order of the windows doesn't matter for the summary
+    __m256i first = _mm256_setzero_si256();
+    __m256i second = _mm256_setzero_si256();
+    for (auto col = 0U; col < size_; ++col) {
+      auto window_codes = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(codes_ptr + i + col));
+      auto low = _mm256_broadcastsi128_si256(_mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(low_.data() + col * codes)));
+      auto high = _mm256_broadcastsi128_si256(_mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(high_.data() + col * codes)));
+      low = _mm256_shuffle_epi8(low, window_codes);
+      high = _mm256_shuffle_epi8(high, window_codes);
+      first = _mm256_adds_epi16(first, _mm256_unpacklo_epi8(low, high));
+      second = _mm256_adds_epi16(second, _mm256_unpackhi_epi8(low, high));
+    }
+    accumulate(first);
+    accumulate(second);
+    // Each 32 bits lane gets at most 4 * 16383 per block
+    if (++pending == 1U << 14) flush();
+  }
+  flush();
+#endif
+
+  if (size_ == 0 || size_ > max_packed) {
+    for (; i < last; ++i) {
+      int score{};
+      for (auto col = 0U; col < size_; ++col)
+        score += values_[col * codes + codes_ptr[i + col]];
+      if (score > limit) {
+        ++hits;
+        sum += score;
+      }
+    }
+    return ScanSummary{hits, sum / scale_};
+  }
+
+  // The window is packed on 2 bits while walking the sequence, valid
+  // counting the bases since the last invalid one
+  std::uint64_t window{};
+  unsigned valid{};
+  const auto top = 2 * (size_ - 1);
+  for (auto pos = i; pos + 1 < last + size_; ++pos) {
+    auto code = codes_ptr[pos];
+    if (code == CodedSequence::invalid) {
+      code = 0;
+      valid = 0;
+    } else {
+      ++valid;
+    }
+    window = (window >> 2) | (std::uint64_t{code} << top);
+    if (pos + 1 < i + size_ || valid < size_) continue;
+    auto s = score(window);
+    if (s > limit) {
+      ++hits;
+      sum += s;
+    }
+  }
+
+  return ScanSummary{hits, sum / scale_};
+}
+
+void QuantizedPWM::score(const CodedSequence& seq, unsigned first,
+                         unsigned count, std::int16_t* scores) const {
+  const auto* codes_ptr = seq.data() + first;
+  auto i = 0U;
+
+#ifdef __AVX2__
+  for (; i + 32 <= count; i += 32) {
+    __m256i first_half = _mm256_setzero_si256();
+    __m256i second_half = _mm256_setzero_si256();
+    for (auto col = 0U; col < size_; ++col) {
+      auto window_codes = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(codes_ptr + i + col));
+      auto low = _mm256_broadcastsi128_si256(_mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(low_.data() + col * codes)));
+      auto high = _mm256_broadcastsi128_si256(_mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(high_.data() + col * codes)));
+      low = _mm256_shuffle_epi8(low, window_codes);
+      high = _mm256_shuffle_epi8(high, window_codes);
+      first_half = _mm256_adds_epi16(first_half,
+                                     _mm256_unpacklo_epi8(low, high));
+      second_half = _mm256_adds_epi16(second_half,
+                                      _mm256_unpackhi_epi8(low, high));
+    }
+    // Windows 0-7 and 16-23 are in first_half, 8-15 and 24-31 in
+    // second_half
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(scores + i),
+        _mm256_permute2x128_si256(first_half, second_half, 0x20));
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(scores + i + 16),
+        _mm256_permute2x128_si256(first_half, second_half, 0x31));
+  }
+#endif
+
+  if (size_ == 0 || size_ > max_packed) {
+    for (; i < count; ++i) {
+      int score{};
+      for (auto col = 0U; col < size_; ++col)
+        score += values_[col * codes + codes_ptr[i + col]];
+      scores[i] = std::max(score, int{invalid_value});
+    }
+    return;
+  }
+
+  // As in scan(), the window is packed while walking the sequence
+  std::uint64_t window{};
+  unsigned valid{};
+  const auto top = 2 * (size_ - 1);
+  for (auto pos = i; pos < count + size_ - 1; ++pos) {
+    auto code = codes_ptr[pos];
+    if (code == CodedSequence::invalid) {
+      code = 0;
+      valid = 0;
+    } else {
+      ++valid;
+    }
+    window = (window >> 2) | (std::uint64_t{code} << top);
+    if (pos + 1 < i + size_) continue;
+    scores[pos + 1 - size_] = valid < size_ ? invalid_value : score(window);
+  }
+}
+
+std::int32_t QuantizedPWM::score(std::uint64_t window) const {
+  std::int32_t res{};
+  for (auto b = 0U; b * PWM::block_size < size_; ++b) {
+    res += blocks_[b * block_entries + (window & (block_entries - 1))];
+    window >>= 2 * PWM::block_size;
+  }
+  return res;
+}
+
+std::int16_t QuantizedPWM::quantize(double threshold) const {
+  auto q = std::floor(threshold * scale_);
+  return std::min(std::max(q, -max_score - 1.),
+                  double{std::numeric_limits<std::int16_t>::max()});
+}
+
+}  // namespace dna
+}  // namespace ctga
+
+//
+// quantized_pwm.cpp ends here
@@ -0,0 +1,256 @@
+// quantized_pwm.hpp ---
+//
+// Filename: quantized_pwm.hpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-14T10:12:43+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+
+#ifndef CTGA_DNA_QUANTIZED_PWM_HPP_
+#define CTGA_DNA_QUANTIZED_PWM_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include "ctga/dna/mask.hpp"
+#include "ctga/dna/pwm.hpp"
+#include "ctga/dna/sequence.hpp"
+
+namespace ctga {
+namespace dna {
+
+/**
+ *  \brief Sequence encoded for the quantized scoring, one byte per base
+ *
+ *  A, C, G and T are coded 0 to 3. The ambiguous and masked bases get the
+ *  invalid code, so that no window containing them reaches a threshold.
+ */
+class CodedSequence {
+ public:
+  /** \brief Code of the bases that can't be scored */
+  static constexpr std::uint8_t invalid = 4;
+
+  /**
+   *  \brief Encode a sequence
+   *
+   *  \param seq Sequence to encode
+   */
+  explicit CodedSequence(const Sequence& seq) : CodedSequence{seq, Mask{}} {}
+
+  /**
+   *  \brief Encode a sequence, invalidating its masked regions
+   *
+   *  \param seq Sequence to encode
+   *  \param mask Regions of the sequence to skip
+   */
+  CodedSequence(const Sequence& seq, const Mask& mask);
+
+  /**
+   *  \brief Get the number of bases
+   *
+   *  \return Number of bases
+   */
+  inline unsigned size() const { return codes_.size(); }
+
+  /**
+   *  \brief Get the codes
+   *
+   *  \return Pointer to the first code
+   */
+  inline const std::uint8_t* data() const { return codes_.data(); }
+
+ private:
+  std::vector<std::uint8_t> codes_; /*!< Code of each base */
+};
+
+/** \brief Hits of a PWM in a sequence */
+struct ScanSummary {
+  unsigned hits; /*!< Number of windows scoring above the threshold */
+  double sum;    /*!< Sum of the scores of these windows */
+};
+
+/**
+ *  \brief PWM quantized on 16 bits integers
+ *
+ *  Each log-odds value is multiplied by a common scale and rounded, the
+ *  scale being the largest one keeping any window score within 14 bits.
+ *  Each column is stored as a table of 16 values indexed by base code, the
+ *  invalid codes mapping to -32768: with saturating additions, a window
+ *  containing an invalid base ends below any valid score.
+ *
+ *  With AVX2, 32 windows are scored at once, the table lookups being
+ *  byte shuffles. Otherwise, the windows are packed on 2 bits while
+ *  scanning and scored by blocks of PWM::block_size columns, with a lookup
+ *  per block in a table of the partial scores of every k-mer.
+ */
+class QuantizedPWM {
+ public:
+  /** \brief Lowest quantized score of a window without invalid bases */
+  static constexpr std::int16_t lowest = -16383;
+
+  /**
+   *  \brief Quantize a PWM
+   *
+   *  \param pwm PWM to quantize
+   */
+  explicit QuantizedPWM(const PWM& pwm);
+
+  /**
+   *  \brief Quantize log-odds values
+   *
+   *  Same result as quantizing the PWM holding these values, without
+   *  building it (e.g. from the values of a FixedPWM).
+   *
+   *  \param values Values, a row per base (A, C, G, T) and a column per
+   *  position
+   */
+  explicit QuantizedPWM(const Eigen::Ref<const Eigen::MatrixXd>& values);
+
+  /**
+   *  \brief Get the width of the PWM
+   *
+   *  \return Number of columns
+   */
+  inline unsigned size() const { return size_; }
+
+  /**
+   *  \brief Get the factor applied to the log-odds values
+   *
+   *  \return Scale of the quantized values
+   */
+  inline double scale() const { return scale_; }
+
+  /**
+   *  \brief Get the largest difference between the score of a window and
+   *  its quantized score
+   *
+   *  \return Rounding error bound, in log-odds units
+   */
+  inline double error() const { return 0.5 * size_ / scale_; }
+
+  /**
+   *  \brief Score the window of a sequence starting at a given position
+   *
+   *  \param seq Encoded sequence
+   *  \param pos Position of the first base of the window
+   *  \return Quantized score of the window, in log-odds units
+   */
+  double score(const CodedSequence& seq, unsigned pos) const;
+
+  /**
+   *  \brief Count the windows scoring above a threshold and sum their scores
+   *
+   *  Windows start before seq.size() - size(), as for the other scans, and
+   *  those containing an invalid base are skipped. Scores are compared
+   *  after quantization, so windows within error() of the threshold may be
+   *  classified differently than with PWM::score.
+   *
+   *  \param seq Encoded sequence
+   *  \param threshold Windows must score strictly above it
+   *  \return Number of hits and sum of their scores
+   */
+  ScanSummary scan(const CodedSequence& seq, double threshold) const;
+
+  /**
+   *  \brief Score consecutive windows of a sequence
+   *
+   *  The windows containing an invalid base score below lowest. Every
+   *  window must fit in the sequence.
+   *
+   *  \param seq Encoded sequence
+   *  \param first Position of the first window
+   *  \param count Number of windows
+   *  \param scores Receives the quantized score of each window
+   */
+  void score(const CodedSequence& seq, unsigned first, unsigned count,
+             std::int16_t* scores) const;
+
+  /**
+   *  \brief Score a window packed on 2 bits
+   *
+   *  \param window Codes of the bases, the first one in the lowest bits;
+   *  the PWM must have at most 32 columns
+   *  \return Quantized score of the window
+   */
+  std::int32_t score(std::uint64_t window) const;
+
+  /**
+   *  \brief Get the quantized PWM of the reverse complement
+   *
+   *  The values are permuted rather than quantized again, so that a window
+   *  and its reverse complement get exactly the same score.
+   *
+   *  \return Quantized reverse complement
+   */
+  QuantizedPWM rev_complement() const;
+
+  /**
+   *  \brief Quantize a threshold
+   *
+   *  The threshold is clamped so that invalid windows stay below it.
+   *
+   *  \param threshold Threshold, in log-odds units
+   *  \return Quantized threshold: windows must score strictly above it
+   */
+  std::int16_t quantize(double threshold) const;
+
+ private:
+  static constexpr unsigned codes = 16; /*!< Entries of a column table */
+
+  unsigned size_;                   /*!< Number of columns */
+  double scale_;                    /*!< Quantization factor */
+  std::vector<std::int16_t> values_; /*!< Column tables, indexed by
+                                        col * codes + base code */
+  std::vector<std::uint8_t> low_;   /*!< Low bytes of values_ */
+  std::vector<std::uint8_t> high_;  /*!< High bytes of values_ */
+  std::vector<std::int32_t> blocks_; /*!< Partial score of each k-mer of a
+                                        block of columns */
+
+  QuantizedPWM() = default;
+
+  // Byte tables and k-mer blocks, from values_
+  void build_tables();
+};
+
+}  // namespace dna
+}  // namespace ctga
+
+#endif  // CTGA_DNA_QUANTIZED_PWM_HPP_
+
+//
+// quantized_pwm.hpp ends here
@@ -0,0 +1,105 @@
+// score_distribution.cpp ---
+//
+// Filename: score_distribution.cpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-16T15:27:08+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+#include "ctga/dna/score_distribution.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace ctga {
+namespace dna {
+
+ScoreDistribution::ScoreDistribution(const Eigen::MatrixXd& values,
+                                     const std::array<double, 4>& background) :
+    step_{min_step}, error_{}, min_{}, tail_{} {
+  double range{};
+  for (auto col = 0U; col < values.cols(); ++col)
+    range += values.col(col).maxCoeff() - values.col(col).minCoeff();
+  step_ = std::max(min_step, range / (max_bins - 1));
+  error_ = 0.5 * step_ * values.cols();
+
+  // Distribution of the rounded scores, shifted so that the lowest is 0
+  std::vector<double> dist{1.}, next{};
+  for (auto col = 0U; col < values.cols(); ++col) {
+    std::array<long, 4> q{};
+    for (auto b = 0U; b < 4; ++b) q[b] = std::lround(values(b, col) / step_);
+    auto low = *std::min_element(q.begin(), q.end());
+    auto high = *std::max_element(q.begin(), q.end());
+    min_ += low;
+
+    next.assign(dist.size() + (high - low), 0.);
+    for (auto b = 0U; b < 4; ++b) {
+      auto shift = q[b] - low;
+      for (auto k = 0U; k < dist.size(); ++k)
+        next[k + shift] += dist[k] * background[b];
+    }
+    dist.swap(next);
+  }
+
+  tail_.assign(dist.size() + 1, 0.);
+  for (auto k = dist.size(); k > 0; --k)
+    tail_[k - 1] = tail_[k] + dist[k - 1];
+}
+
+double ScoreDistribution::p_value(double score) const {
+  auto k = static_cast<long>(std::ceil(score / step_ - 1e-9)) - min_;
+  if (k <= 0) return tail_.front();
+  if (k >= static_cast<long>(tail_.size())) return 0.;
+  return tail_[k];
+}
+
+double ScoreDistribution::threshold(double p_value) const {
+  // First k with P(S > k) = tail_[k + 1] <= p_value; tail_ decreases
+  auto it = std::lower_bound(tail_.begin() + 1, tail_.end(), p_value,
+                             [](double t, double p) { return t > p; });
+  long k = it - tail_.begin() - 1;
+  // Every window may be a hit
+  if (tail_.front() <= p_value) return min_ * step_ - error_ - step_;
+  return (min_ + k) * step_ + error_;
+}
+
+}  // namespace dna
+}  // namespace ctga
+
+//
+// score_distribution.cpp ends here
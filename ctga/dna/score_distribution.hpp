@@ -0,0 +1,121 @@
+// score_distribution.hpp ---
+//
+// Filename: score_distribution.hpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-16T15:27:08+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+
+#ifndef CTGA_DNA_SCORE_DISTRIBUTION_HPP_
+#define CTGA_DNA_SCORE_DISTRIBUTION_HPP_
+
+#include <eigen3/Eigen/Core>
+#include <array>
+#include <vector>
+
+namespace ctga {
+namespace dna {
+
+/**
+ *  \brief Exact distribution of the scores of a PWM under a background
+ *
+ *  Scores are rounded to multiples of a step, and the distribution of their
+ *  sum over the columns is computed by dynamic programming, each column
+ *  convolving it with the background frequencies of the bases. The
+ *  distribution is exact for the rounded scores, which differ from the
+ *  actual ones by at most width * step / 2.
+ */
+class ScoreDistribution {
+ public:
+  /** \brief Finest step used to round the scores */
+  static constexpr double min_step = 1e-3;
+  /** \brief Largest number of distinct rounded scores */
+  static constexpr unsigned max_bins = 1U << 17;
+
+  /**
+   *  \brief Compute the distribution of the scores of a PWM
+   *
+   *  \param values Log-odds values, a row per base (A, C, G, T) and a column
+   *  per position
+   *  \param background Frequencies of A, C, G and T
+   */
+  ScoreDistribution(const Eigen::MatrixXd& values,
+                    const std::array<double, 4>& background);
+
+  /**
+   *  \brief Get the probability for a random window to score at least a
+   *  given score
+   *
+   *  \param score Score
+   *  \return P(S >= score)
+   */
+  double p_value(double score) const;
+
+  /**
+   *  \brief Get the lowest threshold a random window exceeds with at most a
+   *  given probability
+   *
+   *  The threshold is raised by the rounding error bound, so that the
+   *  probability holds for the actual scores.
+   *
+   *  \param p_value Probability
+   *  \return Lowest t such that P(S > t) <= p_value
+   */
+  double threshold(double p_value) const;
+
+  /**
+   *  \brief Get the step of the rounded scores
+   *
+   *  \return Step
+   */
+  inline double step() const { return step_; }
+
+ private:
+  double step_;              /*!< Step of the rounded scores */
+  double error_;             /*!< Largest rounding error of a score */
+  long min_;                 /*!< Lowest rounded score, in steps */
+  std::vector<double> tail_; /*!< tail_[k]: P(S >= (min_ + k) * step_) */
+};
+
+}  // namespace dna
+}  // namespace ctga
+
+#endif  // CTGA_DNA_SCORE_DISTRIBUTION_HPP_
+
+//
+// score_distribution.hpp ends here
@@ -0,0 +1,250 @@
+// search.cpp ---
+//
+// Filename: search.cpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-02-26T11:02:19+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+#include "ctga/dna/search.hpp"
+
+#include <boost/filesystem.hpp>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ctga/dna/alphabet.hpp"
+#include "ctga/dna/fixed_scan.hpp"
+#include "ctga/dna/mask.hpp"
+#include "ctga/dna/packed_sequence.hpp"
+#include "ctga/dna/sequence.hpp"
+
+namespace ctga {
+namespace dna {
+
+namespace {
+/** \brief Version of the cost model, to invalidate outdated cache files */
+constexpr unsigned model_version = 3;
+
+/** \brief Expected number of columns compared before reaching tolerance + 1
+ *  errors in a random sequence */
+inline double expected_columns(unsigned width, unsigned tolerance) {
+  return std::min<double>(width, (tolerance + 1) * 4. / 3.);
+}
+
+/** \brief Time taken to pack a sequence on 2 bits, in ns per base */
+double measure_two_bit_prepare(const Sequence& seq) {
+  double best{std::numeric_limits<double>::infinity()};
+  for (auto rep = 0U; rep < 3; ++rep) {
+    auto start = std::chrono::steady_clock::now();
+    PackedSequence<DNA4> codes{seq};
+    auto ambiguous = mask_ambiguous(seq);
+    auto stop = std::chrono::steady_clock::now();
+    if (codes.size() + ambiguous.masked() == 0) return 0.;
+    best = std::min(best, std::chrono::duration<double, std::nano>(
+        stop - start).count());
+  }
+  return best / seq.size();
+}
+
+/** \brief Time taken by an engine to scan a sequence, in ns per window */
+double measure(const Sequence& seq, const Sequence& motif, unsigned tolerance,
+               Engine e) {
+  double best{std::numeric_limits<double>::infinity()};
+  for (auto rep = 0U; rep < 3; ++rep) {
+    auto start = std::chrono::steady_clock::now();
+    auto hits = seq.find_similar(motif, tolerance, e);
+    auto stop = std::chrono::steady_clock::now();
+    // Keep the result alive so the scan is not optimised away
+    if (hits.size() > seq.size()) return 0.;
+    best = std::min(best, std::chrono::duration<double, std::nano>(
+        stop - start).count());
+  }
+  return best / (seq.size() - motif.size());
+}
+}  // namespace
+
+std::ostream& operator<<(std::ostream& os, const Engine& e) {
+  switch (e) {
+    case Engine::naive: os << "naive"; break;
+    case Engine::packed: os << "packed"; break;
+    case Engine::two_bit: os << "two_bit"; break;
+    case Engine::unrolled: os << "unrolled"; break;
+  }
+  return os;
+}
+
+std::ostream& operator<<(std::ostream& os, const Plan& p) {
+  os << p.engine << " (predicted " << p.cost / 1e6 << " ms)";
+  return os;
+}
+
+const SearchPlanner& SearchPlanner::get() {
+  static const SearchPlanner planner{};
+  return planner;
+}
+
+SearchPlanner::SearchPlanner() : costs_{} {
+  auto path = cache_path();
+  if (!load(path)) {
+    calibrate();
+    save(path);
+  }
+}
+
+Plan SearchPlanner::plan(unsigned width, unsigned tolerance,
+                         std::size_t length, unsigned queries) const {
+  Plan res{Engine::naive, cost(Engine::naive, width, tolerance, length,
+                               queries)};
+  for (auto i = 1U; i < n_engines; ++i) {
+    auto e = static_cast<Engine>(i);
+    auto c = cost(e, width, tolerance, length, queries);
+    if (c < res.cost) res = Plan{e, c};
+  }
+  return res;
+}
+
+double SearchPlanner::cost(Engine e, unsigned width, unsigned tolerance,
+                           std::size_t length, unsigned queries) const {
+  double columns{};
+  switch (e) {
+    case Engine::naive:
+      columns = expected_columns(width, tolerance);
+      break;
+    case Engine::packed:
+    case Engine::two_bit:
+      if (width == 0 || width > Motif::max_size)
+        return std::numeric_limits<double>::infinity();
+      break;
+    case Engine::unrolled:
+      // No early exit: every column of every window is compared
+      if (!has_fixed_scanner(width, tolerance))
+        return std::numeric_limits<double>::infinity();
+      columns = width;
+      break;
+  }
+  const auto& c = costs(e);
+  double windows = length > width ? length - width : 0;
+  return length * c.prepare
+      + queries * windows * (c.per_window + c.per_column * columns);
+}
+
+void SearchPlanner::calibrate() {
+  // Random sequence, identical on every run
+  std::mt19937 gen{42};
+  std::vector<Base> bases(1U << 16);
+  for (auto& b : bases) b = static_cast<Base>(gen() % 4);
+  Sequence seq{std::move(bases)};
+
+  // Two queries with different numbers of compared columns
+  auto short_motif = seq.subsequence(100, 108);
+  auto long_motif = seq.subsequence(200, 216);
+  auto e1 = expected_columns(8, 0), e2 = expected_columns(16, 3);
+
+  for (auto i = 0U; i < n_engines; ++i) {
+    auto e = static_cast<Engine>(i);
+    auto t1 = measure(seq, short_motif, 0, e);
+    auto t2 = measure(seq, long_motif, 3, e);
+    auto& c = costs_[i];
+    c.prepare = 0.;
+    switch (e) {
+      case Engine::naive:
+        c.per_column = std::max(0., (t2 - t1) / (e2 - e1));
+        c.per_window = std::max(0., t1 - c.per_column * e1);
+        break;
+      case Engine::packed:
+        c.per_column = 0.;
+        c.per_window = (t1 + t2) / 2;
+        break;
+      case Engine::two_bit:
+        // Measured times include packing the sequence once
+        c.prepare = measure_two_bit_prepare(seq);
+        c.per_column = 0.;
+        c.per_window = std::max(
+            0., (t1 + t2) / 2 - c.prepare * seq.size() / (seq.size() - 16));
+        break;
+      case Engine::unrolled:
+        c.per_column = std::max(0., (t2 - t1) / (16. - 8.));
+        c.per_window = std::max(0., t1 - c.per_column * 8.);
+        break;
+    }
+  }
+}
+
+bool SearchPlanner::load(const std::string& path) {
+  std::ifstream input{path};
+  unsigned version{}, engines{};
+  if (!(input >> version >> engines)
+      || version != model_version || engines != n_engines)
+    return false;
+  for (auto& c : costs_)
+    if (!(input >> c.prepare >> c.per_window >> c.per_column)) return false;
+  return true;
+}
+
+void SearchPlanner::save(const std::string& path) const {
+  boost::system::error_code ec{};
+  boost::filesystem::create_directories(
+      boost::filesystem::path{path}.parent_path(), ec);
+  std::ofstream output{path};
+  output << model_version << " " << n_engines << "\n";
+  for (const auto& c : costs_)
+    output << c.prepare << " " << c.per_window << " " << c.per_column << "\n";
+}
+
+std::string SearchPlanner::cache_path() {
+  if (const char* env = std::getenv("CTGA_PLANNER_CACHE")) return env;
+
+  char host[256] = {};
+  if (gethostname(host, sizeof(host) - 1) != 0) host[0] = '\0';
+  const char* home = std::getenv("HOME");
+  return std::string{home != nullptr ? home : "."}
+      + "/.cache/ctga/planner-" + host;
+}
+
+}  // namespace dna
+}  // namespace ctga
+
+//
+// search.cpp ends here
@@ -0,0 +1,183 @@
+// search.hpp ---
+//
+// Filename: search.hpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-02-26T10:21:44+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+
+#ifndef CTGA_DNA_SEARCH_HPP_
+#define CTGA_DNA_SEARCH_HPP_
+
+#include <array>
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+namespace ctga {
+namespace dna {
+
+/** \brief Engines available for the approximate search of a motif */
+enum class Engine : unsigned {
+  naive,   /*!< Base by base comparison, stops at the first excess error */
+  packed,  /*!< Packed window slid along the sequence (motifs up to 32 bases) */
+  two_bit,  /*!< Sequence packed on 2 bits, for pure ACGT motifs up to 32 bases;
+              windows with ambiguous bases are compared base by base */
+  unrolled  /*!< Comparison unrolled at compile time, for motifs of 6 to 16
+              bases and up to 3 errors (@see scan_fixed) */
+};
+
+/** \brief Number of search engines */
+constexpr unsigned n_engines = 4;
+
+/** \brief Search engine selected for a query */
+struct Plan {
+  Engine engine; /*!< Selected engine */
+  double cost;   /*!< Predicted cost, in nanoseconds */
+};
+
+/** \brief Write the name of an engine into a stream */
+std::ostream& operator<<(std::ostream& os, const Engine& e);
+/** \brief Write a search plan into a stream */
+std::ostream& operator<<(std::ostream& os, const Plan& p);
+
+/**
+ *  \brief Selects the fastest search engine for a query
+ *
+ *  The cost of each engine is modelled as
+ *  length * prepare + queries * windows * (per_window + per_column * columns),
+ *  columns being the expected number of bases compared in a window. The
+ *  coefficients are measured by a short micro-benchmark the first time the
+ *  planner is used, and cached in a file per machine so that it only runs
+ *  once.
+ */
+class SearchPlanner {
+ public:
+  /** \brief Cost coefficients of an engine, in nanoseconds */
+  struct Costs {
+    double prepare;    /*!< Per base of the sequence, once per call */
+    double per_window; /*!< Per window and per query */
+    double per_column; /*!< Per compared column, window and query */
+  };
+
+  /**
+   *  \brief Get the planner, calibrating it if needed
+   *
+   *  \return Planner shared by the whole program
+   */
+  static const SearchPlanner& get();
+
+  /**
+   *  \brief Select the fastest engine for a query
+   *
+   *  \param width Width of the motif
+   *  \param tolerance Number of errors allowed
+   *  \param length Length of the sequence
+   *  \param queries Number of motifs searched in the same sequence
+   *  \return Selected engine and its predicted cost
+   */
+  Plan plan(unsigned width, unsigned tolerance, std::size_t length,
+            unsigned queries) const;
+
+  /**
+   *  \brief Predict the cost of an engine for a query
+   *
+   *  \param e Engine
+   *  \param width Width of the motif
+   *  \param tolerance Number of errors allowed
+   *  \param length Length of the sequence
+   *  \param queries Number of motifs searched in the same sequence
+   *  \return Predicted cost in nanoseconds, infinite if the engine can't be
+   *  used for this query
+   */
+  double cost(Engine e, unsigned width, unsigned tolerance,
+              std::size_t length, unsigned queries) const;
+
+  /**
+   *  \brief Get the cost coefficients of an engine
+   *
+   *  \param e Engine
+   *  \return Cost coefficients
+   */
+  inline const Costs& costs(Engine e) const {
+    return costs_[static_cast<unsigned>(e)];
+  }
+
+  /**
+   *  \brief Measure the cost coefficients of all the engines
+   */
+  void calibrate();
+
+  /**
+   *  \brief Load the cost coefficients from a file
+   *
+   *  \param path Path of the file
+   *  \return True if the file was valid for the current engines
+   */
+  bool load(const std::string& path);
+
+  /**
+   *  \brief Save the cost coefficients into a file
+   *
+   *  \param path Path of the file
+   */
+  void save(const std::string& path) const;
+
+  /**
+   *  \brief Get the path of the cache file of the machine
+   *
+   *  $CTGA_PLANNER_CACHE if defined, ~/.cache/ctga/planner-<hostname>
+   *  otherwise.
+   *
+   *  \return Path of the cache file
+   */
+  static std::string cache_path();
+
+ private:
+  SearchPlanner();
+
+  std::array<Costs, n_engines> costs_; /*!< Coefficients of each engine */
+};
+
+}  // namespace dna
+}  // namespace ctga
+
+#endif  // CTGA_DNA_SEARCH_HPP_
+
+//
+// search.hpp ends here
@@ -52,6 +52,11 @@
 #include <utility>
 #include <vector>
 
+#include "ctga/dna/alphabet.hpp"
+#include "ctga/dna/fixed_scan.hpp"
+#include "ctga/dna/mask.hpp"
+#include "ctga/dna/packed_sequence.hpp"
+#include "ctga/dna/search.hpp"
 #include "ctga/tools/random_generator.hpp"
 
 namespace ctga {
@@ -60,6 +65,123 @@ namespace dna {
 using std::string;
 using std::vector;
 
+namespace {
+/**
+ *  \brief Calls f(pos) for each window of a sequence similar to a packed motif
+ *
+ *  The window is packed once and then slid along the sequence, so that each
+ *  position costs a shift and a popcount.
+ */
+template <typename F>
+void scan_packed(const Sequence& seq, const Motif& motif, unsigned tolerance,
+                 unsigned first, unsigned last, F f) {
+  auto width = motif.size();
+  if (width == 0 || first >= last) return;
+
+  auto window = seq.motif(first, width);
+  for (auto i = first; i < last; ++i) {
+    if (i > first) window.slide(seq[i + width - 1]);
+    if (window.distance(motif) <= tolerance) f(i);
+  }
+}
+
+/** \brief Number of windows of a given width scanned in a sequence */
+inline unsigned n_windows(std::size_t size, unsigned width) {
+  return size > width ? size - width : 0;
+}
+
+/**
+ *  \brief Calls f(first, last) for each range of window starts whose windows
+ *  don't overlap a masked region
+ */
+template <typename F>
+void for_each_window_range(const Sequence& seq, unsigned width,
+                           const Mask& mask, F f) {
+  auto last = n_windows(seq.size(), width);
+  mask.for_each_segment(seq.size(), [&](unsigned start, unsigned stop) {
+      // Windows starting in [start, stop - width] fit in the segment
+      if (stop - start >= width)
+        f(start, std::min(stop - width + 1, last));
+    });
+}
+
+/**
+ *  \brief Runs the queries of a call with a given engine
+ *
+ *  Holds what the engine prepares once per call, such as the 2 bits packed
+ *  sequence, so that it is shared by all the queries and ranges of the call.
+ */
+class Searcher {
+ public:
+  Searcher(const Sequence& seq, Engine engine) :
+      seq_(seq), engine_{engine}, codes_{}, ambiguous_{} {
+    if (engine_ == Engine::two_bit) {
+      codes_ = PackedSequence<DNA4>{seq};
+      ambiguous_ = mask_ambiguous(seq);
+    }
+  }
+
+  /** \brief Calls f(pos) for each window in [first, last) similar to motif */
+  template <typename F>
+  void scan(const Sequence& motif, unsigned tolerance,
+            unsigned first, unsigned last, F f) const {
+    auto width = motif.size();
+    auto engine = engine_;
+    // Engines working on packed motifs fall back when the motif can't be
+    if ((engine == Engine::packed || engine == Engine::two_bit)
+        && (width == 0 || width > Motif::max_size))
+      engine = Engine::naive;
+    if (engine == Engine::two_bit && !mask_ambiguous(motif).intervals().empty())
+      engine = Engine::packed;
+
+    switch (engine) {
+      case Engine::naive:
+        for (auto i = first; i < last; ++i)
+          if (seq_.is_similar_at(i, motif, tolerance)) f(i);
+        break;
+      case Engine::packed:
+        scan_packed(seq_, motif.motif(0, width), tolerance, first, last, f);
+        break;
+      case Engine::two_bit:
+        scan_two_bit(motif, tolerance, first, last, f);
+        break;
+      case Engine::unrolled:
+        if (!scan_fixed(seq_, motif, tolerance, first, last, f))
+          for (auto i = first; i < last; ++i)
+            if (seq_.is_similar_at(i, motif, tolerance)) f(i);
+        break;
+    }
+  }
+
+ private:
+  const Sequence& seq_;
+  Engine engine_;
+  PackedSequence<DNA4> codes_; /*!< Sequence on 2 bits (two_bit only) */
+  Mask ambiguous_;             /*!< Bases codes_ can't hold (two_bit only) */
+
+  // Windows without ambiguous bases are compared on 2 bits, the few others
+  // base by base, keeping the positions in increasing order
+  template <typename F>
+  void scan_two_bit(const Sequence& motif, unsigned tolerance,
+                    unsigned first, unsigned last, F f) const {
+    auto width = motif.size();
+    auto code = PackedSequence<DNA4>{motif}.window(0, width);
+    auto pos = first;
+    ambiguous_.for_each_segment(first, last + width - 1,
+                                [&](unsigned start, unsigned stop) {
+        if (stop - start < width) return;
+        auto end = std::min(stop - width + 1, last);
+        for (; pos < start; ++pos)
+          if (seq_.is_similar_at(pos, motif, tolerance)) f(pos);
+        codes_.scan(code, width, tolerance, start, end, f);
+        pos = end;
+      });
+    for (; pos < last; ++pos)
+      if (seq_.is_similar_at(pos, motif, tolerance)) f(pos);
+  }
+};
+}  // namespace
+
 Sequence::Sequence(const std::string& str) : bases_{} {
   std::stringstream ss{str};
   bases_ = vector<Base>((std::istream_iterator<Base>(ss)),
@@ -67,6 +189,7 @@ Sequence::Sequence(const std::string& str) : bases_{} {
 }
 
 Sequence::Sequence(const std::vector<double>& vec): bases_{} {
+  bases_.reserve(vec.size());
   for (const auto& d : vec) {
     assert((d <= 4) && (d >= 0));
     switch (static_cast<unsigned>(ceil(d))) {
@@ -91,28 +214,49 @@ Sequence::Sequence(const std::vector<double>& vec): bases_{} {
 }
 
 Sequence::Sequence(const std::vector<Sequence>& vec) : bases_{} {
+  std::size_t total{};
+  for (const auto& seq : vec) total += seq.size();
+  bases_.reserve(total);
   for (const auto& seq : vec) append(seq);
 }
 
 Sequence Sequence::subsequence(unsigned start, unsigned stop) const {
-  assert(start >= 0);
+  Sequence res{};
+  subsequence(start, stop, &res);
+  return res;
+}
+
+void Sequence::subsequence(unsigned start, unsigned stop, Sequence* out) const {
   assert(start < stop);
 
   if (stop > bases_.size())
     stop = bases_.size();
 
-  std::vector<Base> bases{};
-  bases.insert(bases.end(), bases_.begin() + start, bases_.begin() + stop);
-  // std::copy(bases_.begin() + start, bases_.begin() + stop, bases.begin());
-
-  return Sequence{bases};
+  out->bases_.assign(bases_.begin() + start, bases_.begin() + stop);
 }
 
 
+Motif Sequence::motif(unsigned start, unsigned width) const {
+  if (width > Motif::max_size)
+    throw std::runtime_error{"Motif too long to be packed"};
+  Motif res{};
+  for (auto i = start; i < start + width && i < bases_.size(); ++i)
+    res.push_back(bases_[i]);
+  return res;
+}
+
 void Sequence::append(const Sequence& seq) {
   bases_.insert(bases_.end(), seq.bases_.begin(), seq.bases_.end());
 }
 
+void Sequence::append(const Sequence& seq, unsigned start, unsigned stop) {
+  if (stop > seq.bases_.size())
+    stop = seq.bases_.size();
+  if (start < stop)
+    bases_.insert(bases_.end(),
+                  seq.bases_.begin() + start, seq.bases_.begin() + stop);
+}
+
 std::string Sequence::to_string() const {
   std::stringstream ss{};
   ss << *this;
@@ -120,21 +264,52 @@ std::string Sequence::to_string() const {
 }
 
 Sequence Sequence::complement() const {
-  std::vector<Base> comp{};
-  for (const auto& b : bases_)
-    comp.push_back(dna::complement(b));
-  return Sequence{comp};
+  Sequence res{};
+  complement(&res);
+  return res;
+}
+
+void Sequence::complement(Sequence* out) const {
+  out->bases_.resize(bases_.size());
+  std::transform(bases_.begin(), bases_.end(), out->bases_.begin(),
+                 [](Base b) { return dna::complement(b); });
+}
+
+void Sequence::complement_inplace() {
+  complement(this);
 }
 
 Sequence Sequence::reverse() const {
-  std::vector<Base> rev{};
-  for (auto rit = bases_.rbegin(); rit != bases_.rend(); rit++)
-    rev.push_back(*rit);
-  return Sequence{rev};
+  Sequence res{};
+  reverse(&res);
+  return res;
+}
+
+void Sequence::reverse(Sequence* out) const {
+  assert(out != this);
+  out->bases_.assign(bases_.rbegin(), bases_.rend());
+}
+
+void Sequence::reverse_inplace() {
+  std::reverse(bases_.begin(), bases_.end());
 }
 
 Sequence Sequence::rev_complement() const {
-  return complement().reverse();
+  Sequence res{};
+  rev_complement(&res);
+  return res;
+}
+
+void Sequence::rev_complement(Sequence* out) const {
+  assert(out != this);
+  out->bases_.resize(bases_.size());
+  std::transform(bases_.rbegin(), bases_.rend(), out->bases_.begin(),
+                 [](Base b) { return dna::complement(b); });
+}
+
+void Sequence::rev_complement_inplace() {
+  reverse_inplace();
+  complement_inplace();
 }
 
 Sequence Sequence::shuffle() const {
@@ -156,30 +331,147 @@ unsigned Sequence::distance(const Sequence& motif) const {
 
 bool Sequence::is_similar(const Sequence& motif, unsigned tolerance) const {
   assert(motif.size() == bases_.size());
+  return is_similar_at(0, motif, tolerance);
+}
+
+bool Sequence::is_similar_at(unsigned pos, const Sequence& motif,
+                             unsigned tolerance) const {
   unsigned i{}, diff{};
   while (diff <= tolerance && i < motif.size()) {
-    if (!compatible(bases_[i], motif.bases_[i])) diff++;
+    if (!compatible(bases_[pos + i], motif.bases_[i])) diff++;
     i++;
   }
   return diff <= tolerance;
 }
 
+Plan Sequence::search_plan(const Sequence& motif, unsigned tolerance,
+                           unsigned queries) const {
+  return SearchPlanner::get().plan(motif.size(), tolerance, size(), queries);
+}
+
 std::vector<unsigned> Sequence::find_similar(const Sequence& motif,
                                              unsigned tolerance,
                                              unsigned width) const {
+  assert(motif.size() == width);
+  return find_similar(motif, tolerance,
+                      search_plan(motif, tolerance, 1).engine);
+}
+
+std::vector<unsigned> Sequence::find_similar(const Sequence& motif,
+                                             unsigned tolerance,
+                                             Engine engine) const {
   std::vector<unsigned> res{};
-  for (auto i = 0U; i < bases_.size() - width; ++i) {
-    if (subsequence(i, i + width).is_similar(motif, tolerance))
-      res.push_back(i);
-  }
+  Searcher{*this, engine}.scan(motif, tolerance, 0,
+                               n_windows(size(), motif.size()),
+                               [&res](unsigned i) { res.push_back(i); });
+  return res;
+}
+
+void Sequence::find_similar(const Sequence& motif, unsigned tolerance,
+                            HitList* hits) const {
+  Searcher searcher{*this, search_plan(motif, tolerance, 1).engine};
+  searcher.scan(motif, tolerance, 0, n_windows(size(), motif.size()),
+                [hits](unsigned i) { hits->push_back(i); });
+}
+
+void Sequence::find_similar(const Sequence& motif, unsigned tolerance,
+                            const Mask& mask, HitList* hits) const {
+  Searcher searcher{*this, search_plan(motif, tolerance, 1).engine};
+  for_each_window_range(*this, motif.size(), mask,
+                        [&](unsigned first, unsigned last) {
+      searcher.scan(motif, tolerance, first, last,
+                    [hits](unsigned i) { hits->push_back(i); });
+    });
+}
+
+std::vector<unsigned> Sequence::find_similar(const Sequence& motif,
+                                             unsigned tolerance,
+                                             const Mask& mask) const {
+  Searcher searcher{*this, search_plan(motif, tolerance, 1).engine};
+  std::vector<unsigned> res{};
+  for_each_window_range(*this, motif.size(), mask,
+                        [&](unsigned first, unsigned last) {
+      searcher.scan(motif, tolerance, first, last,
+                    [&res](unsigned i) { res.push_back(i); });
+    });
   return res;
 }
 
 unsigned Sequence::count_similar(const Sequence& motif,
                                  unsigned tolerance,
                                  unsigned width) const {
-  return find_similar(motif, tolerance, width).size()
-      + find_similar(motif.rev_complement(), tolerance, width).size();
+  assert(motif.size() == width);
+  Searcher searcher{*this, search_plan(motif, tolerance, 2).engine};
+  auto rev = motif.rev_complement();
+  unsigned res{};
+  auto count = [&res](unsigned) { ++res; };
+  auto last = n_windows(size(), width);
+  searcher.scan(motif, tolerance, 0, last, count);
+  searcher.scan(rev, tolerance, 0, last, count);
+  return res;
+}
+
+unsigned Sequence::count_similar(const Sequence& motif, unsigned tolerance,
+                                 const Mask& mask) const {
+  Searcher searcher{*this, search_plan(motif, tolerance, 2).engine};
+  auto rev = motif.rev_complement();
+  unsigned res{};
+  auto count = [&res](unsigned) { ++res; };
+  for_each_window_range(*this, motif.size(), mask,
+                        [&](unsigned first, unsigned last) {
+      searcher.scan(motif, tolerance, first, last, count);
+      searcher.scan(rev, tolerance, first, last, count);
+    });
+  return res;
+}
+
+std::vector<unsigned> Sequence::find_similar(const Motif& motif,
+                                             unsigned tolerance) const {
+  std::vector<unsigned> res{};
+  scan_packed(*this, motif, tolerance, 0, n_windows(size(), motif.size()),
+              [&res](unsigned i) { res.push_back(i); });
+  return res;
+}
+
+std::vector<unsigned> Sequence::find_similar(const Motif& motif,
+                                             unsigned tolerance,
+                                             const Mask& mask) const {
+  std::vector<unsigned> res{};
+  for_each_window_range(*this, motif.size(), mask,
+                        [&](unsigned first, unsigned last) {
+      scan_packed(*this, motif, tolerance, first, last,
+                  [&res](unsigned i) { res.push_back(i); });
+    });
+  return res;
+}
+
+void Sequence::find_similar(const Motif& motif, unsigned tolerance,
+                            HitList* hits) const {
+  scan_packed(*this, motif, tolerance, 0, n_windows(size(), motif.size()),
+              [hits](unsigned i) { hits->push_back(i); });
+}
+
+unsigned Sequence::count_similar(const Motif& motif,
+                                 unsigned tolerance) const {
+  unsigned res{};
+  auto count = [&res](unsigned) { ++res; };
+  auto last = n_windows(size(), motif.size());
+  scan_packed(*this, motif, tolerance, 0, last, count);
+  scan_packed(*this, motif.rev_complement(), tolerance, 0, last, count);
+  return res;
+}
+
+unsigned Sequence::count_similar(const Motif& motif, unsigned tolerance,
+                                 const Mask& mask) const {
+  unsigned res{};
+  auto count = [&res](unsigned) { ++res; };
+  auto rev = motif.rev_complement();
+  for_each_window_range(*this, motif.size(), mask,
+                        [&](unsigned first, unsigned last) {
+      scan_packed(*this, motif, tolerance, first, last, count);
+      scan_packed(*this, rev, tolerance, first, last, count);
+    });
+  return res;
 }
 
 template<typename A, typename B>
@@ -197,15 +489,35 @@ std::multimap<B, A> flip_map(const std::map<A, B> &src)
   return dst;
 }
 
+void Sequence::count_bases(const HitList& hits, unsigned width,
+                           BaseCounts* counts) const {
+  if (counts->size() < width) counts->resize(width, {{0, 0, 0, 0}});
+  for (auto pos : hits) {
+    for (auto i = 0U; i < width && pos + i < bases_.size(); ++i) {
+      auto b = bases_[pos + i];
+      if (b <= Base::T) (*counts)[i][static_cast<unsigned>(b)]++;
+    }
+  }
+}
+
 Sequence Sequence::find_consensus(const std::vector<Sequence> &seqs) {
+  BaseCounts counts(seqs[0].size(), {{0, 0, 0, 0}});
+  for (const auto& s : seqs) {
+    for (auto i = 0U; i < counts.size(); ++i)
+      if (s[i] <= Base::T) counts[i][static_cast<unsigned>(s[i])]++;
+  }
+  return find_consensus(counts);
+}
+
+Sequence Sequence::find_consensus(const BaseCounts& base_counts) {
   std::vector<Base> consensus{};
 
   // At each position, find the most present bases
-  for (auto i = 0U; i < seqs[0].size(); ++i) {
+  for (auto i = 0U; i < base_counts.size(); ++i) {
     std::cout << "Base at position " << i << std::endl;
-    std::map<Base, unsigned> counts{{Base::A, 0}, {Base::C, 0},
-                                                  {Base::G, 0}, {Base::T, 0}};
-    for (const auto& s : seqs) counts.find(s[i])->second++;
+    std::map<Base, unsigned> counts{
+      {Base::A, base_counts[i][0]}, {Base::C, base_counts[i][1]},
+      {Base::G, base_counts[i][2]}, {Base::T, base_counts[i][3]}};
 
     // Reverse map, it is now sorted by value.
     // Last one is the most frequent bases
@@ -257,19 +569,16 @@ Sequence Sequence::find_consensus(const std::vector<Sequence> &seqs) {
 
 Sequence Sequence::find_consensus(const Sequence& motif,
                                   unsigned tolerance) const {
-  // Find similar motifs
-  auto sim1 = find_similar(motif, tolerance);
-  auto sim2 = find_similar(motif.rev_complement(), tolerance);
-
-  std::vector<Sequence> seqs{};
-
-  // Retrieve all the sequences
-  for (auto i : sim1)
-    seqs.push_back(subsequence(i, i + motif.size()));
-  for (auto i : sim2)
-    seqs.push_back(subsequence(i, i + motif.size()));
-
-  return Sequence::find_consensus(seqs);
+  // Count the bases of the similar motifs, one strand at a time
+  BaseCounts counts(motif.size(), {{0, 0, 0, 0}});
+  HitList hits{};
+  find_similar(motif, tolerance, &hits);
+  count_bases(hits, motif.size(), &counts);
+  hits.clear();
+  find_similar(motif.rev_complement(), tolerance, &hits);
+  count_bases(hits, motif.size(), &counts);
+
+  return Sequence::find_consensus(counts);
 }
 
 Sequence::operator std::vector<double>() const {
@@ -44,17 +44,34 @@
 #ifndef CTGA_DNA_SEQUENCE_HPP_
 #define CTGA_DNA_SEQUENCE_HPP_
 
+#include <boost/random/uniform_int_distribution.hpp>
+
+#include <array>
 #include <iostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "ctga/dna/base.hpp"
+#include "ctga/dna/hit_list.hpp"
+#include "ctga/dna/motif.hpp"
+#include "ctga/dna/search.hpp"
 
 namespace ctga {
 namespace dna {
 
+class Mask;
+
+/** \brief Number of A, C, G and T at each position of aligned windows */
+using BaseCounts = std::vector<std::array<unsigned, 4>>;
+
 
-/** \brief Class defining a strand of DNA */
+/**
+ *  \brief Class defining a strand of DNA
+ *
+ *  Const member functions do not modify any shared state and can be called
+ *  concurrently, except for shuffle() without an explicit generator.
+ */
 class Sequence {
  public:
   /**
@@ -63,6 +80,22 @@ class Sequence {
    *  \param bases Vector of bases in the sequence
    */
   explicit Sequence(const std::vector<Base>& bases) : bases_{bases} {}
+  /**
+   *  \brief Sequence constructor
+   *
+   *  \param bases Vector of bases in the sequence, taken over by the sequence
+   */
+  explicit Sequence(std::vector<Base>&& bases) : bases_{std::move(bases)} {}
+  /**
+   *  \brief Sequence constructor
+   *
+   *  \param motif Packed motif to unpack
+   */
+  explicit Sequence(const Motif& motif) : bases_{motif.bases()} {}
+  /**
+   *  \brief Builds an empty sequence
+   */
+  Sequence() : bases_{} {}
   /**
    *  \brief Sequence constructor
    *
@@ -108,6 +141,19 @@ class Sequence {
    */
   inline unsigned size() const { return bases_.size(); }
 
+  /**
+   *  \brief Reserve memory for a given number of bases
+   *
+   *  \param n Number of bases the sequence should be able to hold without
+   *  reallocating
+   */
+  inline void reserve(unsigned n) { bases_.reserve(n); }
+
+  /**
+   *  \brief Remove all the bases, keeping the allocated memory
+   */
+  inline void clear() { bases_.clear(); }
+
   /**
    *  \brief Appends another sequence to the current one
    *
@@ -115,6 +161,18 @@ class Sequence {
    */
   void append(const Sequence& seq);
 
+  /**
+   *  \brief Appends part of another sequence to the current one
+   *
+   *  Equivalent to append(seq.subsequence(start, stop)) without building the
+   *  intermediate sequence.
+   *
+   *  \param seq Sequence to copy the bases from
+   *  \param start Index of the first base to append (included)
+   *  \param stop Index of the last base to append (excluded)
+   */
+  void append(const Sequence& seq, unsigned start, unsigned stop);
+
   /**
    *  \brief Get a subsequence of the current sequence
    *
@@ -124,6 +182,24 @@ class Sequence {
    */
   Sequence subsequence(unsigned start, unsigned stop) const;
 
+  /**
+   *  \brief Get a subsequence of the current sequence
+   *
+   *  \param start Index of the first base to retrieve (included)
+   *  \param stop Index of the last base to retrieve (excluded)
+   *  \param out Sequence receiving the bases, its memory is reused
+   */
+  void subsequence(unsigned start, unsigned stop, Sequence* out) const;
+
+  /**
+   *  \brief Get a part of the sequence as a packed motif
+   *
+   *  \param start Index of the first base to retrieve (included)
+   *  \param width Number of bases to retrieve (at most Motif::max_size)
+   *  \return Packed motif
+   */
+  Motif motif(unsigned start, unsigned width) const;
+
   /**
    *  \brief Convert the DNA strand to a string representation
    *
@@ -138,6 +214,18 @@ class Sequence {
    */
   Sequence complement() const;
 
+  /**
+   *  \brief Get the complement of the sequence
+   *
+   *  \param out Sequence receiving the complement, its memory is reused
+   */
+  void complement(Sequence* out) const;
+
+  /**
+   *  \brief Replace the sequence by its complement
+   */
+  void complement_inplace();
+
   /**
    *  \brief Get the reverse of the sequence
    *
@@ -145,6 +233,18 @@ class Sequence {
    */
   Sequence reverse() const;
 
+  /**
+   *  \brief Get the reverse of the sequence
+   *
+   *  \param out Sequence receiving the reverse, its memory is reused
+   */
+  void reverse(Sequence* out) const;
+
+  /**
+   *  \brief Replace the sequence by its reverse
+   */
+  void reverse_inplace();
+
   /**
    *  \brief Get the reverse complement of the sequence
    *
@@ -152,13 +252,61 @@ class Sequence {
    */
   Sequence rev_complement() const;
 
+  /**
+   *  \brief Get the reverse complement of the sequence
+   *
+   *  \param out Sequence receiving the reverse complement, its memory is
+   *  reused
+   */
+  void rev_complement(Sequence* out) const;
+
+  /**
+   *  \brief Replace the sequence by its reverse complement
+   */
+  void rev_complement_inplace();
+
   /**
    *  \brief Get a shuffled motif
    *
+   *  Uses the global random generator: not safe to call concurrently.
+   *
    *  \return Shuffled motif based on the current one
    */
   Sequence shuffle() const;
 
+  /**
+   *  \brief Get a shuffled motif
+   *
+   *  Safe to call concurrently as long as each thread uses its own engine.
+   *
+   *  \param gen Uniform random bit generator used for the permutation
+   *  \return Shuffled motif based on the current one
+   */
+  template <typename URBG>
+  Sequence shuffle(URBG& gen) const {
+    Sequence res{};
+    shuffle(gen, &res);
+    return res;
+  }
+
+  /**
+   *  \brief Shuffle the motif into an existing sequence
+   *
+   *  Gives the same permutation as shuffle(gen), reusing the memory of out.
+   *
+   *  \param gen Uniform random bit generator used for the permutation
+   *  \param out Receives the shuffled motif
+   */
+  template <typename URBG>
+  void shuffle(URBG& gen, Sequence* out) const {
+    out->bases_.assign(bases_.begin(), bases_.end());
+    auto& shuffled = out->bases_;
+    for (auto i = shuffled.size(); i > 1; --i) {
+      boost::random::uniform_int_distribution<std::size_t> dist{0, i - 1};
+      std::swap(shuffled[i - 1], shuffled[dist(gen)]);
+    }
+  }
+
   /**
    *  \brief Counts the number of differences between two sequences
    *
@@ -176,9 +324,23 @@ class Sequence {
    */
   bool is_similar(const Sequence& motif, unsigned tolerance) const;
 
+  /**
+   *  \brief Test if the window starting at a given position is similar to a
+   *  motif, without copying it
+   *
+   *  \param pos Position of the first base of the window
+   *  \param motif The motif against which we want to test the window
+   *  \param tolerance The number of errors allowed
+   *  \return True if the window is similar to the motif, false otherwise
+   */
+  bool is_similar_at(unsigned pos, const Sequence& motif,
+                     unsigned tolerance) const;
+
   /**
    *  \brief Given a motif, finds all positions where a similar one is found
    *
+   *  The search engine is selected by the SearchPlanner.
+   *
    *  \param motif Motif to look for
    *  \param Percentage of errors allowed when looking for the motif
    *  \param Width of the motif
@@ -200,6 +362,68 @@ class Sequence {
     return find_similar(motif, tolerance, motif.size());
   }
 
+  /**
+   *  \brief Given a motif, finds all positions where a similar one is found,
+   *  skipping the windows overlapping a masked region
+   *
+   *  \param motif Motif to look for
+   *  \param tolerance Number of errors allowed
+   *  \param mask Regions of the sequence to skip
+   *  \return Positions of the similar windows
+   */
+  std::vector<unsigned> find_similar(const Sequence& motif,
+                                     unsigned tolerance,
+                                     const Mask& mask) const;
+
+  /**
+   *  \brief Given a motif, appends all positions where a similar one is found
+   *  to a compressed hit list
+   *
+   *  \param motif Motif to look for
+   *  \param tolerance Number of errors allowed
+   *  \param hits List receiving the positions; the positions it already
+   *  holds must not be greater than the first one appended
+   */
+  void find_similar(const Sequence& motif, unsigned tolerance,
+                    HitList* hits) const;
+
+  /**
+   *  \brief Given a motif, appends all positions where a similar one is found
+   *  outside of the masked regions to a compressed hit list
+   *
+   *  \param motif Motif to look for
+   *  \param tolerance Number of errors allowed
+   *  \param mask Regions of the sequence to skip
+   *  \param hits List receiving the positions; the positions it already
+   *  holds must not be greater than the first one appended
+   */
+  void find_similar(const Sequence& motif, unsigned tolerance,
+                    const Mask& mask, HitList* hits) const;
+
+  /**
+   *  \brief Given a motif, finds all positions where a similar one is found
+   *  with a given search engine
+   *
+   *  \param motif Motif to look for
+   *  \param tolerance Number of errors allowed
+   *  \param engine Search engine to use
+   *  \return Positions of the similar windows
+   */
+  std::vector<unsigned> find_similar(const Sequence& motif,
+                                     unsigned tolerance,
+                                     Engine engine) const;
+
+  /**
+   *  \brief Get the search engine used to look for a motif
+   *
+   *  \param motif Motif to look for
+   *  \param tolerance Number of errors allowed
+   *  \param queries Number of motifs searched at once (2 for count_similar)
+   *  \return Plan selected by the SearchPlanner
+   */
+  Plan search_plan(const Sequence& motif, unsigned tolerance,
+                   unsigned queries) const;
+
   /**
    *  \brief Count the number of time a motif is approximately found
    *
@@ -231,10 +455,101 @@ class Sequence {
     return count_similar(motif, tolerance, motif.size());
   }
 
+  /**
+   *  \brief Count the number of time a motif is approximately found, on both
+   *  strands, outside of the masked regions
+   *
+   *  \param motif Motif to look for
+   *  \param tolerance Number of errors allowed
+   *  \param mask Regions of the sequence to skip
+   *  \return Number of finds
+   */
+  unsigned count_similar(const Sequence& motif, unsigned tolerance,
+                         const Mask& mask) const;
+
+  /**
+   *  \brief Given a packed motif, finds all positions where a similar one is
+   *  found
+   *
+   *  The windows of the sequence are packed on the fly, so that each one is
+   *  compared to the motif with a few bit operations.
+   *
+   *  \param motif Motif to look for
+   *  \param tolerance Number of errors allowed
+   *  \return Positions of the similar windows
+   */
+  std::vector<unsigned> find_similar(const Motif& motif,
+                                     unsigned tolerance) const;
+
+  /**
+   *  \brief Given a packed motif, appends all positions where a similar one is
+   *  found to a compressed hit list
+   *
+   *  \param motif Motif to look for
+   *  \param tolerance Number of errors allowed
+   *  \param hits List receiving the positions; the positions it already
+   *  holds must not be greater than the first one appended
+   */
+  void find_similar(const Motif& motif, unsigned tolerance,
+                    HitList* hits) const;
+
+  /**
+   *  \brief Given a packed motif, finds all positions where a similar one is
+   *  found, skipping the windows overlapping a masked region
+   *
+   *  \param motif Motif to look for
+   *  \param tolerance Number of errors allowed
+   *  \param mask Regions of the sequence to skip
+   *  \return Positions of the similar windows
+   */
+  std::vector<unsigned> find_similar(const Motif& motif,
+                                     unsigned tolerance,
+                                     const Mask& mask) const;
+
+  /**
+   *  \brief Count the number of time a packed motif is approximately found,
+   *  on both strands
+   *
+   *  \param motif Motif to look for
+   *  \param tolerance Number of errors allowed
+   *  \return Number of finds
+   */
+  unsigned count_similar(const Motif& motif, unsigned tolerance) const;
+
+  /**
+   *  \brief Count the number of time a packed motif is approximately found,
+   *  on both strands, outside of the masked regions
+   *
+   *  \param motif Motif to look for
+   *  \param tolerance Number of errors allowed
+   *  \param mask Regions of the sequence to skip
+   *  \return Number of finds
+   */
+  unsigned count_similar(const Motif& motif, unsigned tolerance,
+                         const Mask& mask) const;
+
   Sequence find_consensus(const Sequence& motif, unsigned tolerance) const;
 
   static Sequence find_consensus(const std::vector<Sequence> &seqs);
 
+  /**
+   *  \brief Build the consensus of aligned windows from their base counts
+   *
+   *  \param counts Number of each base at each position
+   *  \return Consensus
+   */
+  static Sequence find_consensus(const BaseCounts& counts);
+
+  /**
+   *  \brief Count the bases of the windows starting at given positions
+   *
+   *  \param hits Positions of the windows
+   *  \param width Width of the windows
+   *  \param counts Counts to increase, resized to width if needed
+   */
+  void count_bases(const HitList& hits, unsigned width,
+                   BaseCounts* counts) const;
+
   /**
    *  \brief Convert the DNA sequence to a vector of doubles
 
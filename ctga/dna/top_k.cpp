@@ -0,0 +1,84 @@
+// top_k.cpp ---
+//
+// Filename: top_k.cpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-21T14:20:05+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+#include "ctga/dna/top_k.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace ctga {
+namespace dna {
+
+std::ostream& operator<<(std::ostream& os, const Site& s) {
+  os << s.pos << (s.reverse ? " (-) " : " (+) ") << s.score;
+  return os;
+}
+
+bool TopK::push(const Site& site) {
+  if (heap_.size() < k_) {
+    heap_.push_back(site);
+    std::push_heap(heap_.begin(), heap_.end(), better);
+    return true;
+  }
+  if (k_ == 0 || !better(site, heap_.front())) return false;
+
+  std::pop_heap(heap_.begin(), heap_.end(), better);
+  heap_.back() = site;
+  std::push_heap(heap_.begin(), heap_.end(), better);
+  return true;
+}
+
+void TopK::merge(const TopK& other) {
+  for (const auto& site : other.heap_) push(site);
+}
+
+std::vector<Site> TopK::sorted() const {
+  auto res = heap_;
+  std::sort(res.begin(), res.end(), better);
+  return res;
+}
+
+}  // namespace dna
+}  // namespace ctga
+
+//
+// top_k.cpp ends here
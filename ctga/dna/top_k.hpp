@@ -0,0 +1,151 @@
+// top_k.hpp ---
+//
+// Filename: top_k.hpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-21T14:20:05+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+
+#ifndef CTGA_DNA_TOP_K_HPP_
+#define CTGA_DNA_TOP_K_HPP_
+
+#include <iostream>
+#include <limits>
+#include <vector>
+
+namespace ctga {
+namespace dna {
+
+/** \brief Window of a sequence scored by a PWM */
+struct Site {
+  unsigned pos; /*!< Position of the window on the forward strand */
+  bool reverse; /*!< True if the window is read on the reverse strand */
+  double score; /*!< Score of the window */
+};
+
+/**
+ *  \brief Total order of the sites: higher score first, then lower position,
+ *  then forward strand, so that the best sites don't depend on the order in
+ *  which they are found
+ */
+inline bool better(const Site& a, const Site& b) {
+  if (a.score != b.score) return a.score > b.score;
+  if (a.pos != b.pos) return a.pos < b.pos;
+  return !a.reverse && b.reverse;
+}
+
+/** \brief Write a site into a stream */
+std::ostream& operator<<(std::ostream& os, const Site& s);
+
+/**
+ *  \brief Keeps the k best sites pushed into it
+ *
+ *  The sites are held in a min-heap of size k, whose top is the worst kept
+ *  site: its score is the threshold a new site has to reach, which rises as
+ *  better sites are found and can be fed back to the scanner.
+ */
+class TopK {
+ public:
+  /**
+   *  \brief Builds an empty list
+   *
+   *  \param k Number of sites to keep
+   */
+  explicit TopK(unsigned k) : k_{k}, heap_{} { heap_.reserve(k); }
+
+  /**
+   *  \brief Get the number of sites to keep
+   *
+   *  \return k
+   */
+  inline unsigned capacity() const { return k_; }
+
+  /**
+   *  \brief Get the number of sites kept
+   *
+   *  \return Number of sites
+   */
+  inline unsigned size() const { return heap_.size(); }
+
+  /**
+   *  \brief Get the score a site has to reach to be kept
+   *
+   *  \return Score of the worst kept site once k sites are kept, -infinity
+   *  before
+   */
+  inline double threshold() const {
+    if (k_ == 0) return std::numeric_limits<double>::infinity();
+    return heap_.size() < k_ ? -std::numeric_limits<double>::infinity()
+                             : heap_.front().score;
+  }
+
+  /**
+   *  \brief Offer a site
+   *
+   *  \param site Site
+   *  \return True if the site is kept
+   */
+  bool push(const Site& site);
+
+  /**
+   *  \brief Add the sites of another list, for instance found in another
+   *  chunk of the sequence
+   *
+   *  \param other Other list
+   */
+  void merge(const TopK& other);
+
+  /**
+   *  \brief Get the sites kept
+   *
+   *  \return Sites, best first (@see better)
+   */
+  std::vector<Site> sorted() const;
+
+ private:
+  unsigned k_;             /*!< Number of sites to keep */
+  std::vector<Site> heap_; /*!< Kept sites, worst on top */
+};
+
+}  // namespace dna
+}  // namespace ctga
+
+#endif  // CTGA_DNA_TOP_K_HPP_
+
+//
+// top_k.hpp ends here
@@ -0,0 +1,98 @@
+// consensus_cache.cpp ---
+//
+// Filename: consensus_cache.cpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-23T16:02:19+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+#include "ctga/gfd/consensus_cache.hpp"
+
+#include <mutex>
+#include <shared_mutex>
+
+namespace ctga {
+namespace gfd {
+
+ConsensusCache::ConsensusCache(std::size_t capacity) :
+    capacity_{capacity}, counts_{}, order_{}, mutex_{}, hits_{0},
+    misses_{0}, evictions_{0} {
+  counts_.reserve(capacity);
+}
+
+bool ConsensusCache::find(const dna::Motif& consensus,
+                          unsigned* count) const {
+  std::shared_lock<std::shared_mutex> lock{mutex_};
+  auto it = counts_.find(consensus);
+  if (it == counts_.end()) {
+    misses_++;
+    return false;
+  }
+  hits_++;
+  *count = it->second;
+  return true;
+}
+
+void ConsensusCache::insert(const dna::Motif& consensus, unsigned count) {
+  if (capacity_ == 0) return;
+  std::unique_lock<std::shared_mutex> lock{mutex_};
+  if (!counts_.emplace(consensus, count).second) return;
+  order_.push_back(consensus);
+  if (order_.size() > capacity_) {
+    counts_.erase(order_.front());
+    order_.pop_front();
+    evictions_++;
+  }
+}
+
+ConsensusCache::Stats ConsensusCache::stats() const {
+  std::shared_lock<std::shared_mutex> lock{mutex_};
+  return Stats{hits_.load(), misses_.load(), evictions_.load(),
+               counts_.size()};
+}
+
+void ConsensusCache::clear() {
+  std::unique_lock<std::shared_mutex> lock{mutex_};
+  counts_.clear();
+  order_.clear();
+}
+
+}  // namespace gfd
+}  // namespace ctga
+
+//
+// consensus_cache.cpp ends here
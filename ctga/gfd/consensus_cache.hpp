@@ -0,0 +1,152 @@
+// consensus_cache.hpp ---
+//
+// Filename: consensus_cache.hpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-23T16:02:19+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+
+#ifndef CTGA_GFD_CONSENSUS_CACHE_HPP_
+#define CTGA_GFD_CONSENSUS_CACHE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "ctga/dna/motif.hpp"
+
+namespace ctga {
+namespace gfd {
+
+/**
+ *  \brief Number of sites similar to each consensus already searched
+ *
+ *  Successive candidates of an optimiser mostly share their consensus, whose
+ *  count only depends on the sequence: it is only searched the first time.
+ *  Lookups can run concurrently, insertions take an exclusive lock. Once the
+ *  cache is full, the oldest consensus is evicted.
+ */
+class ConsensusCache {
+ public:
+  /** \brief Usage statistics of the cache */
+  struct Stats {
+    std::size_t hits;      /*!< Lookups finding their consensus */
+    std::size_t misses;    /*!< Lookups not finding it */
+    std::size_t evictions; /*!< Consensus evicted to make room */
+    std::size_t size;      /*!< Consensus currently cached */
+
+    /** \brief Proportion of the lookups finding their consensus */
+    inline double hit_rate() const {
+      return hits + misses > 0 ? static_cast<double>(hits) / (hits + misses)
+                               : 0.;
+    }
+  };
+
+  /**
+   *  \brief Builds an empty cache
+   *
+   *  \param capacity Maximum number of consensus kept
+   */
+  explicit ConsensusCache(std::size_t capacity);
+
+  /**
+   *  \brief Look for the count of a consensus
+   *
+   *  \param consensus Consensus
+   *  \param count Set to the count if found
+   *  \return True if found
+   */
+  bool find(const dna::Motif& consensus, unsigned* count) const;
+
+  /**
+   *  \brief Add the count of a consensus
+   *
+   *  \param consensus Consensus
+   *  \param count Number of sites similar to it
+   */
+  void insert(const dna::Motif& consensus, unsigned count);
+
+  /**
+   *  \brief Get the count of a consensus, computing it if needed
+   *
+   *  Two threads missing the same consensus at once both compute it.
+   *
+   *  \param consensus Consensus
+   *  \param compute Function returning the count, called on a miss
+   *  \return Count
+   */
+  template <typename F>
+  unsigned get(const dna::Motif& consensus, F compute) {
+    unsigned res{};
+    if (find(consensus, &res)) return res;
+    res = compute();
+    insert(consensus, res);
+    return res;
+  }
+
+  /**
+   *  \brief Get the usage statistics
+   *
+   *  \return Statistics
+   */
+  Stats stats() const;
+
+  /**
+   *  \brief Remove every consensus, keeping the statistics
+   */
+  void clear();
+
+ private:
+  std::size_t capacity_;                          /*!< Maximum size */
+  std::unordered_map<dna::Motif, unsigned> counts_; /*!< Cached counts */
+  std::deque<dna::Motif> order_;                  /*!< Insertion order */
+  mutable std::shared_mutex mutex_;               /*!< Protects the above */
+  mutable std::atomic<std::size_t> hits_;         /*!< Successful lookups */
+  mutable std::atomic<std::size_t> misses_;       /*!< Failed lookups */
+  std::atomic<std::size_t> evictions_;            /*!< Evicted consensus */
+};
+
+}  // namespace gfd
+}  // namespace ctga
+
+#endif  // CTGA_GFD_CONSENSUS_CACHE_HPP_
+
+//
+// consensus_cache.hpp ends here
@@ -0,0 +1,148 @@
+// fitness_kernel.cpp ---
+//
+// Filename: fitness_kernel.cpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-24T09:12:40+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+#include "ctga/gfd/fitness_kernel.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "ctga/dna/alphabet.hpp"
+
+namespace ctga {
+namespace gfd {
+
+FitnessKernel::FitnessKernel(const dna::Sequence& seq,
+                             const dna::Mask& mask) :
+    codes_{seq, mask} {}
+
+FitnessCounts FitnessKernel::operator()(const dna::QuantizedPWM& pwm,
+                                        double threshold,
+                                        const dna::Sequence* consensus,
+                                        unsigned tolerance) const {
+  FitnessCounts res{0, 0., 0};
+  auto width = pwm.size();
+  if (width == 0 || codes_.size() <= width) return res;
+
+  auto rev_pwm = pwm.rev_complement();
+  auto limit = pwm.quantize(threshold);
+
+  // Codes of the consensus and of its reverse complement
+  std::vector<std::uint8_t> forward_codes{}, reverse_codes{};
+  if (consensus) {
+    if (consensus->size() != width)
+      throw std::runtime_error{"Consensus and PWM have different widths"};
+    for (auto col = 0U; col < width; ++col) {
+      auto code = dna::DNA4::code((*consensus)[col]);
+      forward_codes.push_back(code >= 0 ? code : dna::CodedSequence::invalid);
+    }
+    for (auto col = 0U; col < width; ++col) {
+      auto code = forward_codes[width - 1 - col];
+      reverse_codes.push_back(code < 4 ? 3 - code : code);
+    }
+  }
+
+  // Forward windows start before last, reverse ones from 1 to last
+  auto last = codes_.size() - width;
+  std::vector<std::int16_t> scores(block_size), rev_scores(block_size);
+  std::vector<std::uint8_t> mismatches(block_size),
+      rev_mismatches(block_size);
+  std::int64_t sum{};
+  const auto* data = codes_.data();
+
+  for (auto first = 0U; first <= last; first += block_size) {
+    auto count = std::min(block_size, last + 1 - first);
+    pwm.score(codes_, first, count, scores.data());
+    rev_pwm.score(codes_, first, count, rev_scores.data());
+
+    // Invalid windows score below any quantized threshold
+    std::int32_t block_hits{}, block_sum{};
+    for (auto i = 0U; i < count; ++i) {
+      std::int32_t hit = scores[i] > limit;
+      std::int32_t rev_hit = rev_scores[i] > limit;
+      block_hits += hit + rev_hit;
+      block_sum += hit * scores[i] + rev_hit * rev_scores[i];
+    }
+    // The forward window at last and the reverse one at 0 don't exist
+    if (first == 0 && rev_scores[0] > limit) {
+      --block_hits;
+      block_sum -= rev_scores[0];
+    }
+    if (first + count == last + 1 && scores[count - 1] > limit) {
+      --block_hits;
+      block_sum -= scores[count - 1];
+    }
+    res.hits += block_hits;
+    sum += block_sum;
+
+    if (!consensus) continue;
+    std::fill(mismatches.begin(), mismatches.begin() + count, 0);
+    std::fill(rev_mismatches.begin(), rev_mismatches.begin() + count, 0);
+    for (auto col = 0U; col < width; ++col) {
+      const auto* column = data + first + col;
+      auto code = forward_codes[col];
+      auto rev_code = reverse_codes[col];
+      for (auto i = 0U; i < count; ++i) {
+        mismatches[i] += column[i] != code;
+        rev_mismatches[i] += column[i] != rev_code;
+      }
+    }
+    auto stop = std::min(count, last - first);
+    unsigned block_similar{};
+    for (auto i = 0U; i < stop; ++i) {
+      unsigned valid = scores[i] >= dna::QuantizedPWM::lowest;
+      block_similar += valid * ((mismatches[i] <= tolerance)
+                                + (rev_mismatches[i] <= tolerance));
+    }
+    res.similar += block_similar;
+  }
+
+  res.sum = sum / pwm.scale();
+  return res;
+}
+
+}  // namespace gfd
+}  // namespace ctga
+
+//
+// fitness_kernel.cpp ends here
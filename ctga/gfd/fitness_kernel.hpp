@@ -0,0 +1,122 @@
+// fitness_kernel.hpp ---
+//
+// Filename: fitness_kernel.hpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-24T09:12:40+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+
+
+#ifndef CTGA_GFD_FITNESS_KERNEL_HPP_
+#define CTGA_GFD_FITNESS_KERNEL_HPP_
+
+#include "ctga/dna/mask.hpp"
+#include "ctga/dna/quantized_pwm.hpp"
+#include "ctga/dna/sequence.hpp"
+
+namespace ctga {
+namespace gfd {
+
+/** \brief Counts from which the fitness of a PWM is computed */
+struct FitnessCounts {
+  unsigned hits;    /*!< Windows of both strands scoring above the
+                       threshold */
+  double sum;       /*!< Sum of their scores */
+  unsigned similar; /*!< Windows similar to the consensus or to its reverse
+                       complement */
+};
+
+/**
+ *  \brief Computes the counts of a PWM in a single sweep over a sequence
+ *
+ *  The sequence is encoded once. Its windows are then processed by blocks
+ *  small enough to stay in cache: within a block, the windows are scored
+ *  against the PWM and against its reverse complement, and their mismatches
+ *  with the consensus and with its reverse complement are counted, before
+ *  the block is reduced to its counts. Scoring the reverse complement on
+ *  the forward strand replaces the scan of the reverse strand.
+ *
+ *  The windows are those of the other scans: the forward ones start before
+ *  size - width, the reverse ones match the forward starts from 1 to
+ *  size - width. Windows containing a masked or ambiguous base are skipped.
+ */
+class FitnessKernel {
+ public:
+  /** \brief Number of windows per block */
+  static constexpr unsigned block_size = 1U << 12;
+
+  /**
+   *  \brief Encode a sequence
+   *
+   *  \param seq Sequence
+   *  \param mask Regions of the sequence to skip
+   */
+  FitnessKernel(const dna::Sequence& seq, const dna::Mask& mask);
+
+  /**
+   *  \brief Compute the counts of a PWM
+   *
+   *  \param pwm Quantized PWM
+   *  \param threshold Hits must score strictly above it
+   *  \param consensus Consensus of the PWM, nullptr to skip the similar
+   *  windows
+   *  \param tolerance Mismatches allowed for a window to be similar
+   *  \return Hits, sum of their scores, and similar windows
+   */
+  FitnessCounts operator()(const dna::QuantizedPWM& pwm, double threshold,
+                           const dna::Sequence* consensus,
+                           unsigned tolerance) const;
+
+  /**
+   *  \brief Get the number of bases of the sequence
+   *
+   *  \return Number of bases
+   */
+  inline unsigned size() const { return codes_.size(); }
+
+ private:
+  dna::CodedSequence codes_; /*!< Encoded sequence */
+};
+
+}  // namespace gfd
+}  // namespace ctga
+
+#endif  // CTGA_GFD_FITNESS_KERNEL_HPP_
+
+//
+// fitness_kernel.hpp ends here
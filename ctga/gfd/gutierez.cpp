@@ -44,9 +44,12 @@
 #include "ctga/gfd/gutierez.hpp"
 
 #include <algorithm>
+#include <future>
+#include <random>
 #include <vector>
 
 #include "ctga/tools/random_generator.hpp"
+#include "ctga/tools/thread_pool.hpp"
 #include "ctga/tools/statistics.hpp"
 
 #define MAX_MW 0.1
@@ -66,8 +69,7 @@ void Gutierez::operator()(unsigned ngens, unsigned pop_size) {
 
   // init population and evaluate it
   init_population(pop_size);
-  for (auto& indiv : pop_)
-    indiv.evaluate(subs_[generation % subs_.size()]);
+  evaluate_population(generation, false);
 
   // run generations
   while (generation < ngens) {
@@ -80,10 +82,7 @@ void Gutierez::operator()(unsigned ngens, unsigned pop_size) {
     create_offsprings(pop_size, MUTATION_RATE);
 
     // Evaluate the population
-    for (auto& indiv : pop_) {
-      if (generation % subs_.size() == 0) indiv.reset();
-      indiv.evaluate(subs_[generation % subs_.size()]);
-    }
+    evaluate_population(generation, generation % subs_.size() == 0);
     // Refresh the subsequences
     if (generation % subs_.size() == 0) refresh();
   }  // end while
@@ -93,16 +92,53 @@ void Gutierez::operator()(unsigned ngens, unsigned pop_size) {
   // save to file or something
 }
 
+void Gutierez::evaluate_population(unsigned generation, bool reset) {
+  const auto& sub = subs_[generation % subs_.size()];
+  auto pool = tools::ThreadPool::get();
+  auto chunks = std::max<std::size_t>(
+      1, std::min<std::size_t>(pool->size(), pop_.size()));
+
+  // Each chunk has its own buffers, each individual its own generator.
+  // Positions are given in the super sequence, which gives the motifs.
+  auto evaluate_chunk = [&](std::size_t first, std::size_t stop) {
+    Individual::Scratch scratch{};
+    for (auto i = first; i < stop; ++i) {
+      std::seed_seq seeds{seed_, generation, static_cast<unsigned>(i)};
+      std::mt19937 gen{seeds};
+      if (reset) pop_[i].reset();
+      pop_[i].evaluate(super_, sub, 2, &gen, &scratch);
+    }
+  };
+  std::vector<std::future<void>> futures{};
+  for (auto c = 0U; c < chunks; ++c) {
+    auto first = pop_.size() * c / chunks;
+    auto stop = pop_.size() * (c + 1) / chunks;
+    futures.push_back(pool->submit([&evaluate_chunk, first, stop] {
+          evaluate_chunk(first, stop);
+        }));
+  }
+  // The tasks refer to the population: wait for all of them before any
+  // error
+  for (auto& f : futures) f.wait();
+  for (auto& f : futures) f.get();
+}
+
 void Gutierez::refresh() {
   auto copy{original_};
   auto gen = tools::RandomGenerator::get();
   gen->permutation(copy.begin(), copy.end(), copy.size());
-  super_ = dna::Sequence{copy};
 
-  subs_.clear();
+  // Rebuild the super sequence and the subsequences in the buffers of the
+  // previous refresh
+  unsigned total{};
+  for (const auto& seq : copy) total += seq.size();
+  super_.clear();
+  super_.reserve(total);
+  for (const auto& seq : copy) super_.append(seq);
 
+  subs_.resize((super_.size() + sub_size_ - 1) / sub_size_);
   for (auto i = 0U; i < super_.size(); i += sub_size_)
-    subs_.push_back(super_.subsequence(i, i + sub_size_));
+    super_.subsequence(i, i + sub_size_, &subs_[i / sub_size_]);
 }
 
 void Gutierez::decimate() {
@@ -125,19 +161,23 @@ void Gutierez::decimate() {
       } else if ((indiv.alive_for() == 9)
                  && (mw <= MAX_MW / 2.)
                  && tools::statistics::thinness(indiv.fitness(), fits)) {
-        std::vector<dna::Sequence> seqs{};
-        auto motif = super_.subsequence(indiv.position(),
-                                        indiv.position() + motif_size_);
+        auto motif = super_.motif(indiv.position(), motif_size_);
+        auto rev = motif.rev_complement();
 
+        // Stream the hits of each strand into the base counts
+        dna::BaseCounts counts(motif_size_, {{0, 0, 0, 0}});
+        dna::HitList hits{};
         for (const auto& seq : original_) {
-          auto pos = seq.find_similar(motif, 2);
-          for (auto p : pos) seqs.push_back(seq.subsequence(p, motif_size_));
-          pos = seq.find_similar(motif.rev_complement(), 2);
-          for (auto p : pos) seqs.push_back(seq.subsequence(p, motif_size_));
+          hits.clear();
+          seq.find_similar(motif, 2, &hits);
+          seq.count_bases(hits, motif_size_, &counts);
+          hits.clear();
+          seq.find_similar(rev, 2, &hits);
+          seq.count_bases(hits, motif_size_, &counts);
         }
 
         std::cout << "Candidate found: at " << indiv.position()
-                  << " for " << dna::Sequence::find_consensus(seqs)
+                  << " for " << dna::Sequence::find_consensus(counts)
                   << " with proba " << mw / (motif_size_ / 10) << std::endl;
       }
     }
@@ -146,25 +186,19 @@ void Gutierez::decimate() {
 
 void Gutierez::create_offsprings(unsigned pop_size, double mutation_rate) {
   std::vector<Individual> offsprings{};
+  offsprings.reserve(pop_size);
   auto gen = tools::RandomGenerator::get();
 
   for (auto i = 0U; i < pop_size; ++i) {
-    auto id1 = pop_[gen->uniform(pop_.size())];
-    auto id2 = pop_[gen->uniform(pop_.size())];
-
-    // Get the motifs represented by the parents
-    auto parent1 = super_.subsequence(id1.position(),
-                                      id1.position() + motif_size_);
-    auto parent2 = super_.subsequence(id2.position(),
-                                      id2.position() + motif_size_);
+    const auto& id1 = pop_[gen->uniform(pop_.size())];
+    const auto& id2 = pop_[gen->uniform(pop_.size())];
 
     // Select which parts of the parents are transmitted
     auto point = gen->uniform(motif_size_ - 1) + 1;
 
-    // Create the child
-    dna::Sequence child{""};
-    child.append(parent1.subsequence(0, point));
-    child.append(parent2.subsequence(point, motif_size_));
+    // Create the child from the motifs represented by the parents
+    auto child = super_.motif(id1.position(), motif_size_)
+                 .splice(super_.motif(id2.position(), motif_size_), point);
 
     // We now try to match the child to the closest sequence
     // actully found in the sequence
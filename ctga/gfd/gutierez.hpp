@@ -61,11 +61,30 @@ class Gutierez {
 
    *  \param size Size of the submotifs
    *  \param seqs Sequences of DNA to analyse
+   *  \param motifsize Size of the motifs (at most dna::Motif::max_size)
    */
   Gutierez(const std::vector<dna::Sequence>& seqs,
            unsigned subsize, unsigned motifsize) :
+      Gutierez{seqs, subsize, motifsize, 0}
+  {}
+
+  /**
+   *  \brief Initialises a Genetic Algorithm for motif finding
+   *
+   *  The population is evaluated in parallel, each individual drawing its
+   *  control shuffle from a generator seeded by the seed, the generation
+   *  and its rank: evaluations don't depend on the number of threads.
+   *
+   *  \param seqs Sequences of DNA to analyse
+   *  \param size Size of the submotifs
+   *  \param motifsize Size of the motifs (at most dna::Motif::max_size)
+   *  \param seed Seed of the control shuffles
+   */
+  Gutierez(const std::vector<dna::Sequence>& seqs,
+           unsigned subsize, unsigned motifsize, unsigned seed) :
       sub_size_{subsize},
       motif_size_{motifsize},
+      seed_{seed},
       original_{seqs},
       shuffled_{},
       super_{""},
@@ -77,6 +96,7 @@ class Gutierez {
  private:
   unsigned sub_size_;
   unsigned motif_size_;
+  unsigned seed_;
   std::vector<dna::Sequence> original_;
   std::vector<dna::Sequence> shuffled_;
   dna::Sequence super_;
@@ -97,6 +117,14 @@ class Gutierez {
    */
   void refresh();
 
+  /**
+   *  \brief Evaluates the population on the thread pool
+   *
+   *  \param generation Current generation
+   *  \param reset If true, the fitness are reset before the evaluation
+   */
+  void evaluate_population(unsigned generation, bool reset);
+
   void decimate();
 
   void create_offsprings(unsigned pop_size, double mutation_rate);
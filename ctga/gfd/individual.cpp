@@ -52,17 +52,20 @@
 namespace ctga {
 namespace gfd {
 
-void Individual::evaluate(const dna::Sequence &sequence, unsigned tolerance) {
-  auto motif = sequence.subsequence(position_, position_ + size_);
-  auto shuffled = motif.shuffle();
+void Individual::evaluate(const dna::Sequence& origin,
+                          const dna::Sequence& sequence, unsigned tolerance,
+                          std::mt19937* gen, Scratch* scratch) {
+  origin.subsequence(position_, position_ + size_, &scratch->motif);
+  scratch->motif.shuffle(*gen, &scratch->shuffled);
 
-  auto score1 = sequence.count_similar(motif, tolerance);
-  auto score2 = sequence.count_similar(motif, tolerance);
+  auto score1 = sequence.count_similar(scratch->motif, tolerance);
+  auto score2 = sequence.count_similar(scratch->shuffled, tolerance);
 
   mw_orig_.push_back(score1);
   mw_shuf_.push_back(score2);
 
-  fitness_ += score1 - score2;
+  // Counts are unsigned: the control may match more windows
+  fitness_ += static_cast<double>(score1) - static_cast<double>(score2);
 }
 
 double Individual::mw_score(bool force) const {
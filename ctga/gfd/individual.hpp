@@ -44,6 +44,7 @@
 #define CTGA_GFD_INDIVIDUAL_HPP_
 
 #include <iostream>
+#include <random>
 #include <vector>
 
 #include "ctga/dna/sequence.hpp"
@@ -56,6 +57,12 @@ namespace gfd {
  */
 class Individual {
  public:
+  /** \brief Buffers reused by the evaluations of a thread */
+  struct Scratch {
+    dna::Sequence motif;    /*!< Motif of the individual */
+    dna::Sequence shuffled; /*!< Shuffled motif, for the control count */
+  };
+
   /**
    *  \brief Individual constructor
    *
@@ -111,21 +118,22 @@ class Individual {
   inline void reset() { fitness_ = 0.; }
 
   /**
-   *  \brief Evaluates the individual
+   *  \brief Evaluates the individual with its own random stream
    *
-   *  \param sequence DNA sequence against which the individual will be scored
-   *  \param Tolerance Max allowed difference for retrieved motifs
-   */
-  void evaluate(const dna::Sequence& sequence, unsigned tolerance);
-
-  /**
-   *  \brief Evaluates the individual
+   *  The fitness grows by the number of windows similar to the motif minus
+   *  the number of windows similar to a shuffle of it, which may be
+   *  negative. Individuals can be evaluated concurrently as long as each
+   *  thread uses its own generator and buffers. The result only depends on
+   *  the state of the generator.
    *
+   *  \param origin DNA sequence in which the individual's position is given
    *  \param sequence DNA sequence against which the individual will be scored
+   *  \param tolerance Max allowed difference for retrieved motifs
+   *  \param gen Generator of the shuffle of the control motif
+   *  \param scratch Buffers for the motif and its shuffle
    */
-  inline void evaluate(const dna::Sequence& sequence) {
-    return evaluate(sequence, 2);
-  }
+  void evaluate(const dna::Sequence& origin, const dna::Sequence& sequence,
+                unsigned tolerance, std::mt19937* gen, Scratch* scratch);
 
   inline void kill() { survived_ = false; }
 
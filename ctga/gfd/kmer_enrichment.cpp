@@ -0,0 +1,191 @@
+// kmer_enrichment.cpp ---
+//
+// Filename: kmer_enrichment.cpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-28T11:06:52+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+#include "ctga/gfd/kmer_enrichment.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <future>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "ctga/dna/alphabet.hpp"
+#include "ctga/dna/kmer_spectrum.hpp"
+#include "ctga/tools/thread_pool.hpp"
+
+namespace ctga {
+namespace gfd {
+
+namespace {
+/**
+ *  \brief Shuffle the unmasked bases of a sequence, the masked ones staying
+ *  in place
+ */
+template <typename URBG>
+dna::Sequence shuffle_unmasked(const dna::Sequence& seq,
+                               const dna::Mask& mask, URBG& gen) {
+  dna::Sequence bases{};
+  bases.reserve(seq.size());
+  mask.for_each_segment(seq.size(), [&](unsigned start, unsigned stop) {
+      bases.append(seq, start, stop);
+    });
+  auto shuffled = bases.shuffle(gen);
+
+  dna::Sequence res{};
+  res.reserve(seq.size());
+  unsigned pos{}, next{};
+  mask.for_each_segment(seq.size(), [&](unsigned start, unsigned stop) {
+      res.append(seq, pos, start);
+      res.append(shuffled, next, next + stop - start);
+      next += stop - start;
+      pos = stop;
+    });
+  res.append(seq, pos, seq.size());
+  return res;
+}
+}  // namespace
+
+KmerEnrichment::KmerEnrichment(const std::vector<dna::Sequence>& seqs,
+                               const std::vector<dna::Mask>& masks,
+                               unsigned width, unsigned tolerance) :
+    seqs_{seqs},
+    masks_{masks},
+    width_{width},
+    tolerance_{tolerance} {
+  if (masks_.size() != seqs_.size())
+    throw std::runtime_error{"Each sequence needs a mask"};
+}
+
+std::vector<KmerEnrichment::Result> KmerEnrichment::operator()(
+    unsigned backgrounds, unsigned n_best, unsigned seed,
+    unsigned threads) const {
+  dna::KmerSpectrum spectrum{seqs_, masks_, width_, threads};
+  auto observed = spectrum.count_similar(tolerance_, threads);
+
+  // Each shuffle has its own generator, so that the backgrounds don't
+  // depend on the number of threads
+  std::vector<double> expected(observed.size(), 0.);
+  auto pool = tools::ThreadPool::get();
+  for (auto b = 0U; b < backgrounds; ++b) {
+    std::vector<dna::Sequence> shuffled(seqs_.size());
+    auto shuffle = [&](std::size_t first, std::size_t stop) {
+      for (auto i = first; i < stop; ++i) {
+        std::seed_seq seeds{seed, b, static_cast<unsigned>(i)};
+        std::mt19937 gen{seeds};
+        shuffled[i] = shuffle_unmasked(seqs_[i], masks_[i], gen);
+      }
+    };
+    auto chunks = std::max<std::size_t>(
+        1, std::min<std::size_t>(threads, seqs_.size()));
+    std::vector<std::future<void>> futures{};
+    for (auto c = 0U; c < chunks; ++c) {
+      auto first = seqs_.size() * c / chunks;
+      auto stop = seqs_.size() * (c + 1) / chunks;
+      futures.push_back(pool->submit([&shuffle, first, stop] {
+            shuffle(first, stop);
+          }));
+    }
+    for (auto& f : futures) f.wait();
+    for (auto& f : futures) f.get();
+
+    auto counts = dna::KmerSpectrum{shuffled, masks_, width_, threads}
+        .count_similar(tolerance_, threads);
+    for (std::size_t kmer = 0; kmer < counts.size(); ++kmer)
+      expected[kmer] += counts[kmer];
+  }
+  if (backgrounds > 0)
+    for (auto& e : expected) e /= backgrounds;
+
+  std::vector<std::uint32_t> kmers{};
+  for (std::uint32_t kmer = 0; kmer < observed.size(); ++kmer)
+    if (kmer <= spectrum.rev_complement(kmer)) kmers.push_back(kmer);
+  auto score = [&](std::uint32_t kmer) {
+    return std::log2((observed[kmer] + 1.) / (expected[kmer] + 1.));
+  };
+  auto better = [&](std::uint32_t a, std::uint32_t b) {
+    auto sa = score(a), sb = score(b);
+    if (sa != sb) return sa > sb;
+    if (observed[a] != observed[b]) return observed[a] > observed[b];
+    return a < b;
+  };
+  auto n = std::min<std::size_t>(n_best, kmers.size());
+  std::partial_sort(kmers.begin(), kmers.begin() + n, kmers.end(), better);
+
+  std::vector<Result> res{};
+  for (auto i = 0U; i < n; ++i)
+    res.push_back(Result{spectrum.unpack(kmers[i]), observed[kmers[i]],
+                         expected[kmers[i]], score(kmers[i])});
+  return res;
+}
+
+Eigen::VectorXd KmerEnrichment::params(const dna::Sequence& kmer) const {
+  auto width = kmer.size();
+  Eigen::VectorXd res = Eigen::VectorXd::Ones(4 * width);
+  auto add = [&](const dna::Sequence& seq, unsigned pos, bool reverse) {
+    for (auto col = 0U; col < width; ++col) {
+      auto code = reverse ? dna::DNA4::code(seq[pos + width - 1 - col])
+                          : dna::DNA4::code(seq[pos + col]);
+      if (code < 0) continue;
+      res[4 * col + (reverse ? 3 - code : code)] += 1.;
+    }
+  };
+  auto rev = kmer.rev_complement();
+  for (auto i = 0U; i < seqs_.size(); ++i) {
+    const auto& seq = seqs_[i];
+    for (auto pos : seq.find_similar(kmer, tolerance_, masks_[i]))
+      add(seq, pos, false);
+    for (auto pos : seq.find_similar(rev, tolerance_, masks_[i]))
+      add(seq, pos, true);
+  }
+
+  for (auto col = 0U; col < width; ++col)
+    res.segment(4 * col, 4) /= res.segment(4 * col, 4).sum();
+  return res;
+}
+
+}  // namespace gfd
+}  // namespace ctga
+
+//
+// kmer_enrichment.cpp ends here
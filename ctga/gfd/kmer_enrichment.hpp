@@ -0,0 +1,147 @@
+// kmer_enrichment.hpp ---
+//
+// Filename: kmer_enrichment.hpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-28T11:06:52+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+
+
+#ifndef CTGA_GFD_KMER_ENRICHMENT_HPP_
+#define CTGA_GFD_KMER_ENRICHMENT_HPP_
+
+#include <eigen3/Eigen/Core>
+
+#include <vector>
+
+#include "ctga/dna/mask.hpp"
+#include "ctga/dna/sequence.hpp"
+
+namespace ctga {
+namespace gfd {
+
+/**
+ *  \brief Exhaustive search of the k-mers whose approximate occurrences are
+ *  enriched over shuffled sequences
+ *
+ *  Every k-mer is counted with its neighbourhood of k-mers within the
+ *  tolerance, on both strands (@see KmerSpectrum::count_similar), in the
+ *  sequences and in mononucleotide shuffles of them. Windows overlapping a
+ *  masked region are not counted; the shuffles only mix the unmasked bases
+ *  and keep the masks. The k-mers are ranked by the log ratio of their
+ *  count in the sequences to their mean count in the shuffles. The answer
+ *  is exact for the given shuffles, so it can seed the stochastic searches
+ *  (Gutierez, the PWM optimisers).
+ */
+class KmerEnrichment {
+ public:
+  /** \brief Enrichment of a k-mer */
+  struct Result {
+    dna::Sequence kmer; /*!< Lowest of the k-mer and its reverse
+                           complement */
+    unsigned observed;  /*!< Similar windows in the sequences */
+    double expected;    /*!< Mean similar windows in the shuffles */
+    double score;       /*!< log2((observed + 1) / (expected + 1)) */
+  };
+
+  /**
+   *  \brief Initialises the search
+   *
+   *  \param seqs Sequences of DNA to analyse
+   *  \param width Length of the k-mers (at most KmerSpectrum::max_width)
+   *  \param tolerance Mismatches allowed for a window to be counted
+   */
+  KmerEnrichment(const std::vector<dna::Sequence>& seqs, unsigned width,
+                 unsigned tolerance) :
+      KmerEnrichment{seqs, std::vector<dna::Mask>(seqs.size()), width,
+                     tolerance} {}
+
+  /**
+   *  \brief Initialises the search, skipping masked regions
+   *
+   *  \param seqs Sequences of DNA to analyse
+   *  \param masks Regions of each sequence to skip
+   *  \param width Length of the k-mers (at most KmerSpectrum::max_width)
+   *  \param tolerance Mismatches allowed for a window to be counted
+   */
+  KmerEnrichment(const std::vector<dna::Sequence>& seqs,
+                 const std::vector<dna::Mask>& masks, unsigned width,
+                 unsigned tolerance);
+
+  /**
+   *  \brief Rank the k-mers
+   *
+   *  A k-mer and its reverse complement having the same counts, only the
+   *  lowest of the two is ranked.
+   *
+   *  \param backgrounds Number of shuffles of the sequences
+   *  \param n_best Number of k-mers returned
+   *  \param seed Seed of the shuffles
+   *  \param threads Number of chunks processed on the thread pool
+   *  \return Most enriched k-mers, best first
+   */
+  std::vector<Result> operator()(unsigned backgrounds, unsigned n_best,
+                                 unsigned seed, unsigned threads) const;
+
+  /**
+   *  \brief Get the parameters of the PWM of the sites of a k-mer
+   *
+   *  The unmasked windows similar to the k-mer, and the reverse complements
+   *  of those similar to its reverse complement, are aligned; the base
+   *  frequencies of each column, with one pseudo-count per base, give the
+   *  parameters of the PWM (@see dna::PWM).
+   *
+   *  \param kmer K-mer
+   *  \return Parameters of the PWM, 4 per column
+   */
+  Eigen::VectorXd params(const dna::Sequence& kmer) const;
+
+ private:
+  std::vector<dna::Sequence> seqs_; /*!< Sequences analysed */
+  std::vector<dna::Mask> masks_;    /*!< Regions of each sequence skipped */
+  unsigned width_;                  /*!< Length of the k-mers */
+  unsigned tolerance_;              /*!< Mismatches allowed */
+};
+
+}  // namespace gfd
+}  // namespace ctga
+
+#endif  // CTGA_GFD_KMER_ENRICHMENT_HPP_
+
+//
+// kmer_enrichment.hpp ends here
@@ -0,0 +1,183 @@
+// mismatch_tracker.cpp ---
+//
+// Filename: mismatch_tracker.cpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-25T14:37:05+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+#include "ctga/gfd/mismatch_tracker.hpp"
+
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include "ctga/dna/alphabet.hpp"
+
+namespace ctga {
+namespace gfd {
+
+namespace {
+/** \brief Added to the mismatches of the windows containing invalid bases */
+constexpr std::uint8_t invalid_window = 128;
+}  // namespace
+
+MismatchTracker::MismatchTracker(const dna::Sequence& seq,
+                                 const dna::Mask& mask,
+                                 const dna::Sequence& motif,
+                                 unsigned tolerance) :
+    codes_{seq, mask},
+    motif_{},
+    tolerance_{tolerance},
+    mismatches_{},
+    rev_mismatches_{},
+    count_{} {
+  auto width = motif.size();
+  if (width == 0 || width >= invalid_window)
+    throw std::runtime_error{"Motif width must be between 1 and 127"};
+  for (auto col = 0U; col < width; ++col) {
+    if (dna::DNA4::code(motif[col]) < 0)
+      throw std::runtime_error{"Motif must only contain A, C, G and T"};
+    motif_.push_back(motif[col]);
+  }
+
+  auto windows = codes_.size() > width ? codes_.size() - width : 0U;
+  mismatches_.assign(windows, 0);
+  rev_mismatches_.assign(windows, 0);
+  std::vector<std::uint8_t> invalid(windows, 0);
+  const auto* data = codes_.data();
+  for (auto col = 0U; col < width; ++col) {
+    const auto* column = data + col;
+    std::uint8_t code = dna::DNA4::code(motif_[col]);
+    std::uint8_t rev_code = 3 - dna::DNA4::code(motif_[width - 1 - col]);
+    for (std::size_t i = 0; i < windows; ++i) {
+      mismatches_[i] += column[i] != code;
+      rev_mismatches_[i] += column[i] != rev_code;
+      invalid[i] |= column[i] == dna::CodedSequence::invalid;
+    }
+  }
+  for (std::size_t i = 0; i < windows; ++i) {
+    std::uint8_t penalty = invalid[i] * invalid_window;
+    mismatches_[i] += penalty;
+    rev_mismatches_[i] += penalty;
+    count_ += (mismatches_[i] <= tolerance_)
+        + (rev_mismatches_[i] <= tolerance_);
+  }
+}
+
+// Only the bases of the windows at col (and at the mirrored column for the
+// reverse complement) are compared again. Invalid bases mismatch both the
+// old and the new base, so that invalid windows stay invalid.
+unsigned MismatchTracker::count_with(unsigned col, dna::Base base) const {
+  auto width = motif_.size();
+  if (col >= width || dna::DNA4::code(base) < 0)
+    throw std::runtime_error{"Invalid change of the motif"};
+  std::uint8_t old_code = dna::DNA4::code(motif_[col]);
+  std::uint8_t new_code = dna::DNA4::code(base);
+  const auto* column = codes_.data() + col;
+  const auto* rev_column = codes_.data() + width - 1 - col;
+
+  std::uint8_t rev_old = 3 - old_code, rev_new = 3 - new_code;
+  const auto* mismatches = mismatches_.data();
+  const auto* rev_mismatches = rev_mismatches_.data();
+  auto tolerance = tolerance_;
+
+  unsigned res{};
+  for (std::size_t i = 0; i < mismatches_.size(); ++i) {
+    std::uint8_t forward = mismatches[i] + (column[i] == old_code)
+        - (column[i] == new_code);
+    std::uint8_t reverse = rev_mismatches[i] + (rev_column[i] == rev_old)
+        - (rev_column[i] == rev_new);
+    res += (forward <= tolerance) + (reverse <= tolerance);
+  }
+  return res;
+}
+
+void MismatchTracker::set(unsigned col, dna::Base base) {
+  auto width = motif_.size();
+  if (col >= width || dna::DNA4::code(base) < 0)
+    throw std::runtime_error{"Invalid change of the motif"};
+  std::uint8_t old_code = dna::DNA4::code(motif_[col]);
+  std::uint8_t new_code = dna::DNA4::code(base);
+  const auto* column = codes_.data() + col;
+  const auto* rev_column = codes_.data() + width - 1 - col;
+
+  std::uint8_t rev_old = 3 - old_code, rev_new = 3 - new_code;
+  auto* mismatches = mismatches_.data();
+  auto* rev_mismatches = rev_mismatches_.data();
+  auto windows = mismatches_.size();
+  auto tolerance = tolerance_;
+
+  unsigned res{};
+  for (std::size_t i = 0; i < windows; ++i) {
+    mismatches[i] += (column[i] == old_code) - (column[i] == new_code);
+    rev_mismatches[i] += (rev_column[i] == rev_old)
+        - (rev_column[i] == rev_new);
+    res += (mismatches[i] <= tolerance) + (rev_mismatches[i] <= tolerance);
+  }
+  motif_[col] = base;
+  count_ = res;
+}
+
+unsigned MismatchTracker::climb(unsigned max_steps) {
+  auto steps = 0U;
+  for (; steps < max_steps; ++steps) {
+    auto best = count_;
+    auto best_col = 0U;
+    auto best_base = dna::Base::A;
+    for (auto col = 0U; col < motif_.size(); ++col)
+      for (auto code = 0; code < 4; ++code) {
+        auto base = static_cast<dna::Base>(code);
+        if (base == motif_[col]) continue;
+        auto count = count_with(col, base);
+        if (count > best) {
+          best = count;
+          best_col = col;
+          best_base = base;
+        }
+      }
+    if (best == count_) break;
+    set(best_col, best_base);
+  }
+  return steps;
+}
+
+}  // namespace gfd
+}  // namespace ctga
+
+//
+// mismatch_tracker.cpp ends here
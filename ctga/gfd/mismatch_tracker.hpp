@@ -0,0 +1,146 @@
+// mismatch_tracker.hpp ---
+//
+// Filename: mismatch_tracker.hpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-25T14:37:05+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+
+
+#ifndef CTGA_GFD_MISMATCH_TRACKER_HPP_
+#define CTGA_GFD_MISMATCH_TRACKER_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include "ctga/dna/base.hpp"
+#include "ctga/dna/mask.hpp"
+#include "ctga/dna/quantized_pwm.hpp"
+#include "ctga/dna/sequence.hpp"
+
+namespace ctga {
+namespace gfd {
+
+/**
+ *  \brief Windows of a sequence similar to a motif, updated as the motif
+ *  changes one position at a time
+ *
+ *  The number of mismatches of each window with the motif, and with its
+ *  reverse complement, is kept. Changing a base of the motif only changes
+ *  the mismatches of each window at that column: the counts are updated in
+ *  a single pass over the sequence instead of being computed again over
+ *  the width of the motif.
+ *
+ *  As for Sequence::count_similar, the windows start before size - width
+ *  and each one is counted once per strand it is similar on. Windows
+ *  containing a masked or ambiguous base are never similar.
+ */
+class MismatchTracker {
+ public:
+  /**
+   *  \brief Count the windows similar to a motif
+   *
+   *  \param seq Sequence
+   *  \param mask Regions of the sequence to skip
+   *  \param motif Initial motif, of A, C, G and T only, at most 127 bases
+   *  \param tolerance Mismatches allowed for a window to be similar
+   */
+  MismatchTracker(const dna::Sequence& seq, const dna::Mask& mask,
+                  const dna::Sequence& motif, unsigned tolerance);
+
+  /**
+   *  \brief Get the current motif
+   *
+   *  \return Motif
+   */
+  inline dna::Sequence motif() const { return dna::Sequence{motif_}; }
+
+  /**
+   *  \brief Get the number of windows similar to the current motif
+   *
+   *  \return Similar windows, on both strands
+   */
+  inline unsigned count() const { return count_; }
+
+  /**
+   *  \brief Count the similar windows if a base of the motif was changed,
+   *  without changing it
+   *
+   *  \param col Position in the motif
+   *  \param base New base
+   *  \return Similar windows, on both strands
+   */
+  unsigned count_with(unsigned col, dna::Base base) const;
+
+  /**
+   *  \brief Change a base of the motif
+   *
+   *  \param col Position in the motif
+   *  \param base New base
+   */
+  void set(unsigned col, dna::Base base);
+
+  /**
+   *  \brief Hill climbing over the single base changes of the motif
+   *
+   *  At each step, every change of a single base is counted and the best
+   *  one is applied, until none improves the count.
+   *
+   *  \param max_steps Maximum number of changes applied
+   *  \return Number of changes applied
+   */
+  unsigned climb(unsigned max_steps);
+
+ private:
+  dna::CodedSequence codes_;                /*!< Encoded sequence */
+  std::vector<dna::Base> motif_;            /*!< Current motif */
+  unsigned tolerance_;                      /*!< Mismatches allowed */
+  std::vector<std::uint8_t> mismatches_;     /*!< Of each window with the
+                                               motif */
+  std::vector<std::uint8_t> rev_mismatches_; /*!< Of each window with the
+                                               reverse complement */
+  unsigned count_;                          /*!< Similar windows */
+};
+
+}  // namespace gfd
+}  // namespace ctga
+
+#endif  // CTGA_GFD_MISMATCH_TRACKER_HPP_
+
+//
+// mismatch_tracker.hpp ends here
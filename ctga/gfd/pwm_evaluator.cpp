@@ -42,43 +42,351 @@
 
 #include "ctga/gfd/pwm_evaluator.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <future>
 #include <iostream>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
 
+#include "ctga/dna/fixed_pwm.hpp"
+#include "ctga/dna/fixed_scan.hpp"
 #include "ctga/dna/pwm.hpp"
 #include "ctga/tools/random_generator.hpp"
 
 namespace ctga {
 namespace gfd {
 
+namespace {
+/** \brief Regions of a sequence to skip: ambiguous and low complexity */
+dna::Mask masked_regions(const dna::Sequence& seq) {
+  auto res = dna::mask_ambiguous(seq);
+  res.merge(dna::mask_dust(seq));
+  return res;
+}
+
+/** \brief Number of consensus whose count is kept */
+constexpr std::size_t consensus_cache_size = 1U << 12;
+
+/** \brief Size of the blocks sampled by the low fidelity evaluations */
+constexpr unsigned sample_block = 1U << 11;
+
+/** \brief Fitness of a PWM from its hits and the matches of its consensus */
+inline double fitness(double sum, double hits, double similar) {
+  return sum / (hits + 1) * (similar - 1.);
+}
+
+/** \brief What the evaluation of a candidate needs from its PWM */
+struct Candidate {
+  dna::QuantizedPWM pwm;   /*!< Quantized PWM */
+  dna::Sequence consensus; /*!< Consensus of the PWM */
+};
+
+/** \brief Build a candidate on the stack, its width being known */
+template <unsigned Width>
+Candidate fixed_candidate(const Eigen::VectorXd& params) {
+  dna::FixedPWM<Width> pwm{params};
+  return Candidate{dna::QuantizedPWM{pwm.values()}, pwm.consensus()};
+}
+
+using CandidateBuilder = Candidate (*)(const Eigen::VectorXd&);
+
+template <std::size_t... I>
+constexpr std::array<CandidateBuilder, sizeof...(I)>
+make_candidate_builders(std::index_sequence<I...>) {
+  return {{&fixed_candidate<dna::fixed_min_width + I>...}};
+}
+
+/** \brief Builders of the candidates, indexed by width, over the widths of
+    the specialised scanners */
+constexpr auto candidate_builders = make_candidate_builders(
+    std::make_index_sequence<dna::fixed_max_width - dna::fixed_min_width
+                             + 1>{});
+}  // namespace
+
+// Masked bases are encoded as invalid: windows overlapping them never reach
+// the threshold
+PWM_Evaluator::PWM_Evaluator(unsigned budget, dna::Sequence seq) :
+    PWM_Evaluator{budget, seq, 1.} {}
+
+PWM_Evaluator::PWM_Evaluator(unsigned budget, dna::Sequence seq,
+                             double p_value) :
+    Evaluator{budget},
+    sequence_{seq},
+    mask_{masked_regions(seq)},
+    p_value_{p_value},
+    kernel_{seq, mask_},
+    batch_{seq, mask_},
+    max_evaluations_{budget},
+    evaluations_{0},
+    similar_cache_{consensus_cache_size},
+    spectrum_{},
+    samples_{},
+    confidence_{},
+    elite_{-std::numeric_limits<double>::infinity()},
+    history_mutex_{},
+    history_{} {}
+
+void PWM_Evaluator::multi_fidelity(double fraction, double confidence,
+                                   unsigned seed) {
+  samples_.clear();
+  confidence_ = confidence;
+
+  // Aligned blocks, drawn without replacement
+  auto slots = sequence_.size() / sample_block;
+  auto k = static_cast<unsigned>(std::lround(fraction * sequence_.size()
+                                             / sample_block));
+  if (k < 2 || 2 * k > slots) return;
+  std::vector<unsigned> starts(slots);
+  std::iota(starts.begin(), starts.end(), 0U);
+  std::mt19937 gen{seed};
+  std::shuffle(starts.begin(), starts.end(), gen);
+  starts.resize(k);
+  std::sort(starts.begin(), starts.end());
+
+  samples_.reserve(k);
+  for (auto slot : starts) {
+    auto start = slot * sample_block;
+    auto stop = start + sample_block;
+    samples_.emplace_back(sequence_.subsequence(start, stop),
+                          mask_.slice(start, stop));
+  }
+}
+
+void PWM_Evaluator::use_spectrum(unsigned width, unsigned threads) {
+  spectrum_ = std::make_unique<dna::KmerSpectrum>(sequence_, mask_, width,
+                                                  threads);
+}
+
+std::vector<PWM_Evaluator::Evaluation> PWM_Evaluator::history() const {
+  std::lock_guard<std::mutex> lock{history_mutex_};
+  return history_;
+}
+
+double PWM_Evaluator::cost() const {
+  std::lock_guard<std::mutex> lock{history_mutex_};
+  return std::accumulate(history_.begin(), history_.end(), 0.,
+                         [](double sum, const Evaluation& e) {
+                           return sum + e.cost;
+                         });
+}
+
+// Exact fitnesses also raise the elite
+void PWM_Evaluator::record(Evaluation evaluation) {
+  if (evaluation.fidelity > 0) {
+    auto elite = elite_.load();
+    while (evaluation.fitness > elite &&
+           !elite_.compare_exchange_weak(elite, evaluation.fitness)) {}
+  }
+  std::lock_guard<std::mutex> lock{history_mutex_};
+  history_.push_back(evaluation);
+}
+
+// Coffee's own counter only sees work(): evaluations_ is the budget
+// enforced for every entry point
 double PWM_Evaluator::work(const Eigen::VectorXd& params) {
-  double res{};
-  double n{};
+  charge(1);
+  return evaluate_candidate(params);
+}
 
-  auto pwm = dna::PWM{params};
-  auto consensus = pwm.consensus();
+std::vector<double> PWM_Evaluator::evaluate(
+    const std::vector<Eigen::VectorXd>& params, tools::ThreadPool* pool) {
+  auto n = charge(params.size());
+  std::vector<std::future<double>> futures{};
+  futures.reserve(n);
+  for (auto i = 0U; i < n; ++i)
+    futures.push_back(pool->submit([this, &params, i] {
+          return evaluate_candidate(params[i]);
+        }));
 
-  auto similar = sequence_.count_similar(consensus, 2);
+  // Every task refers to params: wait for all of them before any error
+  for (auto& f : futures) f.wait();
+  std::vector<double> res{};
+  res.reserve(n);
+  for (auto& f : futures) res.push_back(f.get());
+  return res;
+}
 
-  for (auto i = 0U; i < sequence_.size() - pwm.size(); ++i) {
-    auto score = pwm.score(sequence_.subsequence(i, i + pwm.size()));
-    if (score > 0.) {
-      res += score;
-      n += 1.;
-    }
+unsigned PWM_Evaluator::charge(unsigned n) {
+  auto used = evaluations_.load();
+  unsigned granted{};
+  do {
+    if (used >= max_evaluations_ && n > 0)
+      throw std::runtime_error{"Evaluation budget exhausted"};
+    granted = std::min(n, max_evaluations_ - used);
+  } while (!evaluations_.compare_exchange_weak(used, used + granted));
+  return granted;
+}
+
+double PWM_Evaluator::evaluate_candidate(const Eigen::VectorXd& params) {
+  // Without a p-value, the PWM is only needed quantized: usual widths skip
+  // building a PWM with its k-mer tables, bounds and distribution
+  auto width = static_cast<unsigned>(params.size() / 4);
+  auto fixed = p_value_ >= 1. && params.size() % 4 == 0
+      && width >= dna::fixed_min_width && width <= dna::fixed_max_width;
+  double limit{};
+  auto candidate = fixed
+      ? candidate_builders[width - dna::fixed_min_width](params)
+      : [this, &params, &limit] {
+          auto pwm = dna::PWM{params};
+          limit = threshold(pwm);
+          return Candidate{dna::QuantizedPWM{pwm}, pwm.consensus()};
+        }();
+  const auto& quantized = candidate.pwm;
+  const auto& consensus = candidate.consensus;
+
+  // The spectrum gives the exact fitness without reading the sequence
+  if (spectrum_ && spectrum_->width() == quantized.size()) {
+    auto hits = spectrum_->scan(quantized, limit);
+    auto value = fitness(hits.sum, hits.hits,
+                         spectrum_->count_similar(consensus, 2));
+    record({value, 2, 0.});
+    return value;
   }
 
-  // Looking in the reverse complement
-  for (auto i = 0U; i < sequence_.size() - pwm.size(); ++i) {
-    auto score = pwm.score(rev_comp_.subsequence(i, i + pwm.size()));
-    if (score > 0.) {
-      res += score;
-      n += 1.;
+  // Candidates that can't reach the elite keep their estimate
+  double cost{};
+  if (!samples_.empty()) {
+    auto bounds = estimate(quantized, consensus, limit);
+    cost = static_cast<double>(samples_.size()) * sample_block
+        / sequence_.size();
+    if (bounds.second < elite_.load()) {
+      record({bounds.first, 0, cost});
+      return bounds.first;
     }
   }
 
-  // std::cout << "Found " << n << " positive scores\n";
+  // The consensus is only searched if its count isn't cached
+  FitnessCounts counts{};
+  unsigned similar{};
+  auto cacheable = consensus.size() <= dna::Motif::max_size;
+  if (cacheable &&
+      similar_cache_.find(consensus.motif(0, consensus.size()), &similar)) {
+    counts = kernel_(quantized, limit, nullptr, 2);
+  } else {
+    counts = kernel_(quantized, limit, &consensus, 2);
+    similar = counts.similar;
+    if (cacheable)
+      similar_cache_.insert(consensus.motif(0, consensus.size()), similar);
+  }
+
+  auto value = fitness(counts.sum, counts.hits, similar);
+  record({value, 1, cost + 1.});
+  return value;
+}
+
+std::pair<double, double> PWM_Evaluator::estimate(
+    const dna::QuantizedPWM& pwm, const dna::Sequence& consensus,
+    double limit) const {
+  auto k = samples_.size();
+  std::vector<double> sums(k), hits(k), similar(k);
+  for (auto b = 0U; b < k; ++b) {
+    auto counts = samples_[b](pwm, limit, &consensus, 2);
+    sums[b] = counts.sum;
+    hits[b] = counts.hits;
+    similar[b] = counts.similar;
+  }
+
+  // Counts of the blocks scaled up to the whole sequence
+  auto scaled = [this](double sum, double hit, double sim, double blocks) {
+    auto scale = sequence_.size() / (blocks * sample_block);
+    return fitness(sum * scale, hit * scale, sim * scale);
+  };
+  auto sum = std::accumulate(sums.begin(), sums.end(), 0.);
+  auto hit = std::accumulate(hits.begin(), hits.end(), 0.);
+  auto sim = std::accumulate(similar.begin(), similar.end(), 0.);
+  auto value = scaled(sum, hit, sim, k);
+
+  // Jackknife estimate of the standard error
+  std::vector<double> partial(k);
+  for (auto b = 0U; b < k; ++b)
+    partial[b] = scaled(sum - sums[b], hit - hits[b], sim - similar[b],
+                        k - 1.);
+  auto mean = std::accumulate(partial.begin(), partial.end(), 0.) / k;
+  double variance{};
+  for (auto p : partial) variance += (p - mean) * (p - mean);
+  variance *= (k - 1.) / k;
+
+  return {value, value + confidence_ * std::sqrt(variance)};
+}
+
+std::vector<double> PWM_Evaluator::evaluate_batch(
+    const std::vector<Eigen::VectorXd>& params) {
+  auto charged = charge(params.size());
+  std::vector<dna::PWM> pwms{};
+  pwms.reserve(charged);
+  for (auto i = 0U; i < charged; ++i) pwms.emplace_back(params[i]);
+  if (pwms.empty()) return {};
+
+  // Four columns per PWM: the PWM, its reverse complement, and the matches
+  // of its consensus and of the reverse complement of its consensus
+  auto width = pwms.front().size();
+  Eigen::MatrixXd weights(4 * width, 4 * pwms.size());
+  std::vector<double> limits{};
+  for (auto k = 0U; k < pwms.size(); ++k) {
+    if (pwms[k].size() != width)
+      throw std::runtime_error{"PWMs of a batch must have the same width"};
+    auto consensus = pwms[k].consensus();
+    weights.col(4 * k) = dna::BatchScanner::weights(pwms[k]);
+    weights.col(4 * k + 1) = dna::BatchScanner::rev_weights(pwms[k]);
+    weights.col(4 * k + 2) = dna::BatchScanner::weights(consensus);
+    weights.col(4 * k + 3) =
+        dna::BatchScanner::weights(consensus.rev_complement());
+    limits.push_back(threshold(pwms[k]));
+  }
+
+  // As in work(), windows of the sequence start before size - width, so
+  // those of its reverse complement match forward starts from 1 to
+  // size - width included
+  auto last = sequence_.size() > width ? sequence_.size() - width : 0U;
+  auto min_matches = width - 2.5;
+  std::vector<double> sums(pwms.size()), hits(pwms.size()),
+      similar(pwms.size());
+  batch_.scan(weights, [&](unsigned first, unsigned rows,
+                           const Eigen::MatrixXd& scores,
+                           const Eigen::ArrayXd& valid) {
+      // Rows of the windows counted on each strand
+      auto forward_rows = std::min(rows, last > first ? last - first : 0U);
+      auto reverse_start = first == 0 ? 1U : 0U;
+      auto reverse_rows = rows - reverse_start;
+      auto forward_valid = valid.head(forward_rows);
+      auto reverse_valid = valid.segment(reverse_start, reverse_rows);
+      for (auto k = 0U; k < pwms.size(); ++k) {
+        auto forward = scores.col(4 * k).head(forward_rows).array();
+        auto reverse = scores.col(4 * k + 1).segment(reverse_start,
+                                                     reverse_rows).array();
+        auto matches = scores.col(4 * k + 2).head(forward_rows).array();
+        auto rev_matches = scores.col(4 * k + 3).head(forward_rows).array();
+
+        Eigen::ArrayXd hit = (forward > limits[k]).cast<double>()
+                             * forward_valid;
+        Eigen::ArrayXd rev_hit = (reverse > limits[k]).cast<double>()
+                                 * reverse_valid;
+        sums[k] += (hit * forward).sum() + (rev_hit * reverse).sum();
+        hits[k] += hit.sum() + rev_hit.sum();
+        similar[k] += ((matches > min_matches).cast<double>()
+                       + (rev_matches > min_matches).cast<double>()).matrix()
+                      .dot(forward_valid.matrix());
+      }
+    });
+
+  // Each PWM is recorded as a scan of the whole sequence, though the pass
+  // is shared
+  std::vector<double> res(pwms.size());
+  for (auto k = 0U; k < pwms.size(); ++k) {
+    res[k] = fitness(sums[k], hits[k], similar[k]);
+    record({res[k], 1, 1.});
+  }
+  return res;
+}
 
-  return res / (n + 1) * (similar - 1.);
+double PWM_Evaluator::threshold(const dna::PWM& pwm) const {
+  return p_value_ < 1. ? std::max(0., pwm.threshold(p_value_)) : 0.;
 }
 
 }  // namespace gfd
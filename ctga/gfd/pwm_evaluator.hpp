@@ -45,25 +45,218 @@
 
 #include <coffee/tools/evaluation.hpp>
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "ctga/dna/batch_scanner.hpp"
+#include "ctga/dna/kmer_spectrum.hpp"
+#include "ctga/dna/mask.hpp"
+#include "ctga/dna/quantized_pwm.hpp"
 #include "ctga/dna/sequence.hpp"
 #include "ctga/dna/pwm.hpp"
+#include "ctga/gfd/consensus_cache.hpp"
+#include "ctga/gfd/fitness_kernel.hpp"
+#include "ctga/tools/thread_pool.hpp"
 
 namespace ctga {
 namespace gfd {
 
 class PWM_Evaluator : public Coffee::Tools::Evaluator {
  public:
-  explicit PWM_Evaluator(unsigned budget, dna::Sequence seq) :
-      Evaluator{budget},
-      sequence_{seq},
-      rev_comp_{seq.rev_complement()} {}
+  /** \brief Record of an evaluation */
+  struct Evaluation {
+    double fitness;    /*!< Fitness returned */
+    unsigned fidelity; /*!< 0 if estimated on the samples, 1 if computed on
+                          the whole sequence, 2 if computed exactly on the
+                          k-mer spectrum */
+    double cost;       /*!< Bases scanned, as a fraction of the sequence;
+                          0 on the spectrum, which reads no base */
+  };
+
+  /**
+   *  \brief PWM_Evaluator constructor
+   *
+   *  The ambiguous bases and the low complexity regions of the sequence are
+   *  masked: windows overlapping them are neither scored nor counted.
+   *
+   *  \param budget Number of evaluations allowed
+   *  \param seq Sequence on which the PWMs are evaluated
+   */
+  explicit PWM_Evaluator(unsigned budget, dna::Sequence seq);
+
+  /**
+   *  \brief PWM_Evaluator constructor with a significance level
+   *
+   *  Windows are only counted as hits if their score is positive and has a
+   *  p-value under the background of at most p_value (@see PWM::threshold).
+   *
+   *  \param budget Number of evaluations allowed
+   *  \param seq Sequence on which the PWMs are evaluated
+   *  \param p_value Significance level of the hits, 1 to keep every
+   *  positive score
+   */
+  PWM_Evaluator(unsigned budget, dna::Sequence seq, double p_value);
+
+  /**
+   *  \brief Evaluate a batch of PWMs of the same width in a single pass
+   *
+   *  The windows of the sequence are scored against all the PWMs, their
+   *  reverse complements and their consensus at once (@see BatchScanner).
+   *  Scores are computed in double precision, so they may differ slightly
+   *  from the quantized ones of work(). Each PWM is charged to the budget
+   *  (@see evaluate) and recorded as an evaluation on the whole sequence
+   *  (@see history).
+   *
+   *  \param params Parameters of each PWM
+   *  \return Fitness of each PWM
+   */
+  std::vector<double> evaluate_batch(
+      const std::vector<Eigen::VectorXd>& params);
+
+  /**
+   *  \brief Evaluate the candidates of a generation concurrently
+   *
+   *  Each candidate is evaluated as by work(), as a task of the thread pool,
+   *  the sequence and its encodings being shared read-only. Each candidate
+   *  is charged to the budget in submission order: if the budget runs out
+   *  within the batch, only the first candidates are evaluated.
+   *
+   *  \param params Parameters of each candidate
+   *  \param pool Thread pool running the evaluations
+   *  \return Fitness of each evaluated candidate, in submission order
+   */
+  std::vector<double> evaluate(const std::vector<Eigen::VectorXd>& params,
+                               tools::ThreadPool* pool);
+
+  /**
+   *  \brief Evaluate the candidates of a generation on the shared thread
+   *  pool
+   *
+   *  \param params Parameters of each candidate
+   *  \return Fitness of each evaluated candidate, in submission order
+   */
+  inline std::vector<double> evaluate(
+      const std::vector<Eigen::VectorXd>& params) {
+    return evaluate(params, tools::ThreadPool::get());
+  }
+
+  /**
+   *  \brief Switch to multi-fidelity evaluations
+   *
+   *  A fixed random subset of blocks of the sequence is drawn. Each candidate
+   *  is first evaluated on these blocks only, its fitness on the whole
+   *  sequence being estimated by scaling up its hits and similar sites. A
+   *  jackknife over the blocks gives the standard error of the estimate:
+   *  only the candidates whose upper bound (estimate plus confidence times
+   *  the standard error) reaches the best fitness computed so far on the
+   *  whole sequence are evaluated on it. The others get their estimate.
+   *
+   *  Nothing changes if the blocks would cover more than half the sequence.
+   *  Must be called before any evaluation.
+   *
+   *  \param fraction Fraction of the sequence sampled
+   *  \param confidence Number of standard errors of the upper bound
+   *  \param seed Seed of the draw of the blocks
+   */
+  void multi_fidelity(double fraction, double confidence, unsigned seed);
+
+  /**
+   *  \brief Evaluate the PWMs of a given width on the k-mer spectrum of the
+   *  sequence
+   *
+   *  The k-mers of the sequence are counted once (@see KmerSpectrum). The
+   *  PWMs of that width are then evaluated in a time depending on the
+   *  width only, with the same fitness as on the sequence; the other ones
+   *  are evaluated as before. These evaluations are recorded with fidelity
+   *  2 and no cost. Must be called before any evaluation.
+   *
+   *  \param width Width of the PWMs, at most KmerSpectrum::max_width
+   *  \param threads Number of chunks counted in parallel
+   */
+  void use_spectrum(unsigned width, unsigned threads);
+
+  /**
+   *  \brief Get the record of every evaluation done so far
+   *
+   *  \return Fitness, fidelity and cost of each evaluation, in completion
+   *  order
+   */
+  std::vector<Evaluation> history() const;
+
+  /**
+   *  \brief Get the total cost of the evaluations done so far
+   *
+   *  \return Bases scanned, as a number of whole sequences
+   */
+  double cost() const;
+
+  /**
+   *  \brief Get the statistics of the consensus cache
+   *
+   *  \return Hits, misses and size of the cache
+   */
+  inline ConsensusCache::Stats cache_stats() const {
+    return similar_cache_.stats();
+  }
+
+  /**
+   *  \brief Get the regions of the sequence that are never scored
+   *
+   *  \return Ambiguous and low complexity regions of the sequence
+   */
+  inline const dna::Mask& mask() const { return mask_; }
+
+  /**
+   *  \brief Get the number of evaluations left
+   *
+   *  The budget is shared by work(), evaluate() and evaluate_batch(): once
+   *  it is spent, each of them throws.
+   *
+   *  \return Evaluations left in the budget
+   */
+  inline unsigned remaining() const {
+    auto used = evaluations_.load();
+    return used < max_evaluations_ ? max_evaluations_ - used : 0;
+  }
 
  protected:
   double work(const Eigen::VectorXd& params) override;
 
  private:
   dna::Sequence sequence_;
-  dna::Sequence rev_comp_;
+  dna::Mask mask_;     /*!< Masked regions of the sequence */
+  double p_value_;     /*!< Significance level of the hits */
+  FitnessKernel kernel_;         /*!< Sequence encoded for scoring */
+  dna::BatchScanner batch_;      /*!< Sequence encoded for batches */
+  unsigned max_evaluations_;             /*!< Budget */
+  std::atomic<unsigned> evaluations_;    /*!< Evaluations charged so far */
+  mutable ConsensusCache similar_cache_; /*!< Sites similar to each
+                                            consensus */
+
+  std::unique_ptr<dna::KmerSpectrum> spectrum_; /*!< K-mers of the sequence,
+                                                   if used */
+  std::vector<FitnessKernel> samples_; /*!< Blocks of the low fidelity
+                                          evaluations, if any */
+  double confidence_;         /*!< Standard errors of the upper bound */
+  std::atomic<double> elite_; /*!< Best fitness on the whole sequence */
+  mutable std::mutex history_mutex_;
+  std::vector<Evaluation> history_; /*!< Record of each evaluation */
+
+  // Hits must score above it
+  double threshold(const dna::PWM& pwm) const;
+  // Fitness of a candidate, safe to call from several threads
+  double evaluate_candidate(const Eigen::VectorXd& params);
+  // Fitness estimated on the samples, and its upper confidence bound
+  std::pair<double, double> estimate(const dna::QuantizedPWM& pwm,
+                                     const dna::Sequence& consensus,
+                                     double limit) const;
+  void record(Evaluation evaluation);
+  // Charge up to n evaluations to the budget, returning how many were
+  // granted; throws if the budget is already spent
+  unsigned charge(unsigned n);
 };
 
 }  // namespace gfd
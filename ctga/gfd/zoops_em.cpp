@@ -0,0 +1,197 @@
+// zoops_em.cpp ---
+//
+// Filename: zoops_em.cpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-30T15:20:33+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+#include "ctga/gfd/zoops_em.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <future>
+#include <stdexcept>
+#include <vector>
+
+#include "ctga/dna/pwm.hpp"
+#include "ctga/tools/statistics.hpp"
+#include "ctga/tools/thread_pool.hpp"
+
+namespace ctga {
+namespace gfd {
+
+namespace {
+/** \brief Initial fraction of the records having a site */
+constexpr double initial_gamma = 0.5;
+/** \brief Pseudo-count added to each base of each column */
+constexpr double pseudo_count = 0.25;
+
+/** \brief Contribution of a record to the M-step */
+struct Expectation {
+  Eigen::MatrixXd counts; /*!< Expected base counts of each column */
+  double site;            /*!< Probability of the record having a site */
+};
+}  // namespace
+
+ZoopsEM::ZoopsEM(const std::vector<dna::Sequence>& records) :
+    ZoopsEM{records, std::vector<dna::Mask>(records.size())} {}
+
+ZoopsEM::ZoopsEM(const std::vector<dna::Sequence>& records,
+                 const std::vector<dna::Mask>& masks) : records_{} {
+  if (masks.size() != records.size())
+    throw std::runtime_error{"Each record needs a mask"};
+  records_.reserve(records.size());
+  for (auto r = 0U; r < records.size(); ++r)
+    records_.emplace_back(records[r], masks[r]);
+}
+
+ZoopsEM::Result ZoopsEM::operator()(const Eigen::VectorXd& params,
+                                    unsigned max_iterations,
+                                    double tolerance,
+                                    unsigned threads) const {
+  if (params.size() == 0 || params.size() % 4 != 0)
+    throw std::runtime_error{"PWM parameters must come by 4"};
+  const unsigned width = params.size() / 4;
+
+  // The optimisers' parameters may have columns summing to zero
+  Result res{params, initial_gamma, 0};
+  for (auto col = 0U; col < width; ++col)
+    tools::statistics::normalise_inplace(res.params.segment(4 * col, 4),
+                                         0.001);
+
+  std::vector<Expectation> expectations(records_.size());
+  auto chunks = std::max<std::size_t>(
+      1, std::min<std::size_t>(threads, records_.size()));
+  auto pool = tools::ThreadPool::get();
+
+  while (res.iterations < max_iterations) {
+    auto forward = dna::QuantizedPWM{dna::PWM{res.params}};
+    auto reverse = forward.rev_complement();
+    auto gamma = res.gamma;
+
+    // E-step: the likelihood ratio of a window is 2^score, the background
+    // being uniform
+    auto expect = [&](std::size_t first, std::size_t stop) {
+      std::vector<std::int16_t> scores{}, rev_scores{};
+      std::vector<double> weights{}, rev_weights{};
+      for (auto r = first; r < stop; ++r) {
+        const auto& codes = records_[r];
+        auto& e = expectations[r];
+        e.counts = Eigen::MatrixXd::Zero(4, width);
+        e.site = 0.;
+        if (codes.size() < width) continue;
+        auto windows = codes.size() - width + 1;
+        scores.resize(windows);
+        rev_scores.resize(windows);
+        weights.resize(windows);
+        rev_weights.resize(windows);
+        forward.score(codes, 0, windows, scores.data());
+        reverse.score(codes, 0, windows, rev_scores.data());
+
+        double total{};
+        unsigned valid{};
+        for (auto j = 0U; j < windows; ++j) {
+          auto ok = scores[j] >= dna::QuantizedPWM::lowest;
+          weights[j] = ok ? std::exp2(scores[j] / forward.scale()) : 0.;
+          rev_weights[j] = ok ? std::exp2(rev_scores[j] / forward.scale())
+                              : 0.;
+          total += weights[j] + rev_weights[j];
+          valid += 2 * ok;
+        }
+        if (valid == 0) continue;
+        auto prior = gamma / valid;
+        auto norm = prior / (1. - gamma + prior * total);
+        e.site = norm * total;
+
+        // M-step counts: column col of a reverse window is the complement
+        // of its base at width - 1 - col. Windows with an invalid base
+        // have no weight.
+        std::vector<double> sums(4 * width, 0.);
+        for (auto j = 0U; j < windows; ++j) {
+          if (weights[j] == 0.) continue;
+          const auto* window = codes.data() + j;
+          for (auto col = 0U; col < width; ++col) {
+            sums[4 * col + window[col]] += weights[j];
+            sums[4 * col + 3 - window[width - 1 - col]] += rev_weights[j];
+          }
+        }
+        for (auto col = 0U; col < width; ++col)
+          for (auto b = 0U; b < 4; ++b)
+            e.counts(b, col) = norm * sums[4 * col + b];
+      }
+    };
+    std::vector<std::future<void>> futures{};
+    for (auto c = 0U; c < chunks; ++c) {
+      auto first = records_.size() * c / chunks;
+      auto stop = records_.size() * (c + 1) / chunks;
+      futures.push_back(pool->submit([&expect, first, stop] {
+            expect(first, stop);
+          }));
+    }
+    for (auto& f : futures) f.wait();
+    for (auto& f : futures) f.get();
+
+    // M-step, in record order
+    Eigen::MatrixXd counts = Eigen::MatrixXd::Constant(4, width,
+                                                       pseudo_count);
+    double sites{};
+    for (const auto& e : expectations) {
+      if (e.counts.size() > 0) counts += e.counts;
+      sites += e.site;
+    }
+    Eigen::VectorXd next(4 * width);
+    for (auto col = 0U; col < width; ++col)
+      next.segment(4 * col, 4) = counts.col(col) / counts.col(col).sum();
+
+    auto change = (next - res.params).cwiseAbs().maxCoeff();
+    res.params = next;
+    if (!records_.empty())
+      res.gamma = std::min(std::max(sites / records_.size(), 1e-6),
+                           1. - 1e-6);
+    ++res.iterations;
+    if (change <= tolerance) break;
+  }
+  return res;
+}
+
+}  // namespace gfd
+}  // namespace ctga
+
+//
+// zoops_em.cpp ends here
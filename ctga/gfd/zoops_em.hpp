@@ -0,0 +1,120 @@
+// zoops_em.hpp ---
+//
+// Filename: zoops_em.hpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-30T15:20:33+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+
+
+#ifndef CTGA_GFD_ZOOPS_EM_HPP_
+#define CTGA_GFD_ZOOPS_EM_HPP_
+
+#include <eigen3/Eigen/Core>
+
+#include <vector>
+
+#include "ctga/dna/mask.hpp"
+#include "ctga/dna/quantized_pwm.hpp"
+#include "ctga/dna/sequence.hpp"
+
+namespace ctga {
+namespace gfd {
+
+/**
+ *  \brief Refinement of a PWM by expectation-maximisation, each record
+ *  having zero or one site (ZOOPS model)
+ *
+ *  The E-step scores every window of both strands of each record with the
+ *  quantized PWM (@see QuantizedPWM::score), and turns the scores into the
+ *  posterior probability of the window being the site of its record. The
+ *  M-step adds, for each column, the posteriors of the windows having each
+ *  base there. Records are processed in chunks on the shared thread pool;
+ *  their contributions are added in record order, so the result doesn't
+ *  depend on the number of threads. The background is uniform, as in PWM.
+ */
+class ZoopsEM {
+ public:
+  /** \brief Outcome of a refinement */
+  struct Result {
+    Eigen::VectorXd params; /*!< Parameters of the refined PWM */
+    double gamma;           /*!< Fraction of the records having a site */
+    unsigned iterations;    /*!< Number of EM passes done */
+  };
+
+  /**
+   *  \brief Encode the records
+   *
+   *  \param records Sequences, each one having at most one site
+   */
+  explicit ZoopsEM(const std::vector<dna::Sequence>& records);
+
+  /**
+   *  \brief Encode the records, windows overlapping their masks having no
+   *  weight
+   *
+   *  \param records Sequences, each one having at most one site
+   *  \param masks Regions of each record to skip
+   */
+  ZoopsEM(const std::vector<dna::Sequence>& records,
+          const std::vector<dna::Mask>& masks);
+
+  /**
+   *  \brief Refine a PWM
+   *
+   *  \param params Parameters of the initial PWM (@see dna::PWM)
+   *  \param max_iterations Maximum number of EM passes
+   *  \param tolerance Stop once no probability of the PWM changes by more
+   *  \param threads Number of chunks of records processed on the thread
+   *  pool
+   *  \return Refined parameters
+   */
+  Result operator()(const Eigen::VectorXd& params, unsigned max_iterations,
+                    double tolerance, unsigned threads) const;
+
+ private:
+  std::vector<dna::CodedSequence> records_; /*!< Encoded records */
+};
+
+}  // namespace gfd
+}  // namespace ctga
+
+#endif  // CTGA_GFD_ZOOPS_EM_HPP_
+
+//
+// zoops_em.hpp ends here
@@ -48,10 +48,14 @@
 
 #include <algorithm>
 #include <iostream>
+#include <thread>
 #include <vector>
 
 #include "ctga/gfd/gutierez.hpp"
+#include "ctga/gfd/kmer_enrichment.hpp"
+#include "ctga/gfd/mismatch_tracker.hpp"
 #include "ctga/gfd/pwm_evaluator.hpp"
+#include "ctga/gfd/zoops_em.hpp"
 #include "ctga/tools/io.hpp"
 #include "ctga/tools/random_generator.hpp"
 #include "ctga/tools/mann_whitney.hpp"
@@ -78,19 +82,45 @@ int main(int, char**) {
   auto nParams = motif_width * 4;
 
   auto evaluator = ctga::gfd::PWM_Evaluator{50 * 1000, full};
+  // Every candidate has the motif's width, so all of them are evaluated on
+  // the k-mer counts instead of the sequence
+  evaluator.use_spectrum(motif_width, std::thread::hardware_concurrency());
   unsigned portfolioType{};
 
 
-  std::vector<unsigned> optimisers{8};
+  // Seeding: each of the most enriched k-mers starts an optimiser from
+  // the PWM of its sites, with a smaller step; without seeds, a single
+  // optimiser starts from the flat PWM. K-mers are counted outside the
+  // regions the evaluator masks
+  unsigned n_seeds{4};
+  auto enrichment = ctga::gfd::KmerEnrichment{{full}, {evaluator.mask()},
+                                              motif_width, 1};
+  auto seeds = enrichment(3, n_seeds, 42,
+                          std::thread::hardware_concurrency());
+  for (const auto& s : seeds)
+    cout << "Seed: " << s.kmer << " (" << s.observed << " sites, "
+         << s.expected << " expected)" << endl;
+
+  std::vector<unsigned> optimisers(std::max<std::size_t>(1, seeds.size()),
+                                   8);
   auto reevalFormula = GiNaC::numeric{1};
   // Optimisers params
   auto params = Coffee::Optimisers::get_default_parameters(optimisers, nParams);
-  params[0]->bounds = Coffee::Optimisers::Bounds{0., 1.};
-  std::vector<double> mean{0.5};
-  params[0]->meanInit = mean;
-  params[0]->sigmaInit = std::vector<double>{1. / 6};
-  params[0]->minimise = false;
-  params[0]->mu = 60;
+  for (auto i = 0U; i < optimisers.size(); ++i) {
+    params[i]->bounds = Coffee::Optimisers::Bounds{0., 1.};
+    if (i < seeds.size()) {
+      auto init = enrichment.params(seeds[i].kmer);
+      params[i]->meanInit = std::vector<double>(init.data(),
+                                                init.data() + init.size());
+      params[i]->sigmaInit = std::vector<double>{1. / 12};
+    } else {
+      std::vector<double> mean{0.5};
+      params[i]->meanInit = mean;
+      params[i]->sigmaInit = std::vector<double>{1. / 6};
+    }
+    params[i]->minimise = false;
+    params[i]->mu = 60;
+  }
   auto portfolio = Coffee::Portfolios::get_portfolio(
       portfolioType, &evaluator, optimisers, params);
   portfolio->set_restart(false);
@@ -102,6 +132,8 @@ int main(int, char**) {
   Eigen::VectorXd best{portfolio->best_params()};
   ctga::dna::PWM best_pwm{best};
 
+  cout << "Search plan: " << full.search_plan(best_pwm.consensus(), 2, 2)
+       << endl;
   auto list = full.count_similar(best_pwm.consensus(), 2);
 
   for (const auto& s : full.find_similar(best_pwm.consensus(), 2))
@@ -112,10 +144,48 @@ int main(int, char**) {
 
   cout << "Matched " << list << endl;
 
+  auto history = evaluator.history();
+  auto with_fidelity = [&history](unsigned fidelity) {
+    return std::count_if(
+        history.begin(), history.end(),
+        [fidelity](const ctga::gfd::PWM_Evaluator::Evaluation& e) {
+          return e.fidelity == fidelity;
+        });
+  };
+  cout << "Evaluations: " << history.size() << " (" << with_fidelity(2)
+       << " on the k-mer spectrum, " << with_fidelity(1)
+       << " on the whole sequence), cost: " << evaluator.cost()
+       << " sequence scans" << endl;
+
   cout << "Optimization result:\n" << best_pwm.to_proba() << endl
        << "Consensus is: " << best_pwm.consensus()
        << "\nReverse is  : " << best_pwm.consensus().rev_complement() << endl;
 
+  // Local search around the consensus, on the windows the evaluator scores
+  ctga::gfd::MismatchTracker tracker{full, evaluator.mask(),
+                                     best_pwm.consensus(), 2};
+  auto steps = tracker.climb(motif_width);
+  cout << "Refined consensus: " << tracker.motif() << " (" << steps
+       << " changes, " << tracker.count() << " matches)" << endl;
+
+  // EM refinement of the PWM, the sequence being cut in records of at most
+  // one site each, masked as for the evaluator
+  unsigned record_size{1000};
+  std::vector<Sequence> records{};
+  std::vector<ctga::dna::Mask> record_masks{};
+  for (auto i = 0U; i < full.size(); i += record_size) {
+    auto stop = std::min<unsigned>(i + record_size, full.size());
+    records.push_back(full.subsequence(i, stop));
+    record_masks.push_back(evaluator.mask().slice(i, stop));
+  }
+  auto refined = ctga::gfd::ZoopsEM{records, record_masks}(
+      best, 50, 1e-3, std::thread::hardware_concurrency());
+  ctga::dna::PWM refined_pwm{refined.params};
+  cout << "EM refinement (" << refined.iterations << " passes, "
+       << refined.gamma * 100 << "% of the records with a site):\n"
+       << refined_pwm.to_proba() << endl
+       << "Consensus is: " << refined_pwm.consensus() << endl;
+
   return 0;
 }
 
@@ -48,6 +48,7 @@
 #include <string>
 #include <vector>
 
+#include "ctga/dna/mask.hpp"
 #include "ctga/dna/sequence.hpp"
 
 namespace ctga {
@@ -59,12 +60,20 @@ using std::string;
 using std::vector;
 
 std::vector<dna::Sequence> read_file(const std::string& path) {
+  return read_file(path, nullptr);
+}
+
+std::vector<dna::Sequence> read_file(const std::string& path,
+                                     std::vector<dna::Mask>* soft_masks) {
   std::vector<dna::Sequence> res{};
   string data{};
   std::ifstream input{path};
   if (input.is_open()) {
     while (getline(input, data)) {
-      if (data[0] != '>') res.push_back(dna::Sequence{data});
+      if (data[0] != '>') {
+        res.push_back(dna::Sequence{data});
+        if (soft_masks != nullptr) soft_masks->push_back(dna::mask_soft(data));
+      }
     }
   }
   input.close();
@@ -48,6 +48,7 @@
 #include <string>
 #include <vector>
 
+#include "ctga/dna/mask.hpp"
 #include "ctga/dna/sequence.hpp"
 
 /** \namespace ctga::tools::io
@@ -83,6 +84,17 @@ namespace io {
  */
 std::vector<dna::Sequence> read_file(const std::string& path);
 
+/**
+ *  \brief Reads a fasta formated file and gets the sequences it contains,
+ *  along with their soft-masked regions.
+ *
+ *  \param path Path to the file to read
+ *  \param soft_masks Filled with the lowercase regions of each sequence
+ *  \return Vector of DNA sequences
+ */
+std::vector<dna::Sequence> read_file(const std::string& path,
+                                     std::vector<dna::Mask>* soft_masks);
+
 
 }  // namespace io
 }  // namespace tools
@@ -153,30 +153,8 @@ double thinness(double val, const std::vector<double> &vec) {
 
 Eigen::VectorXd normalise(const Eigen::VectorXd& values,
                           double threshold) {
-  double sum = values.sum();
-
-  // counts values that would be below the threshold after normalization
-  unsigned under{};
-  double delta{};
-  for (auto i = 0U; i < values.rows(); ++i)
-    if (values[i] / sum < threshold) {
-      under++;
-      delta += (threshold - values[i] / sum);
-    }
-
-  Eigen::VectorXd res(4);
-
-  for (auto i = 0U; i < values.rows(); ++i) {
-    if (values[i] / sum - delta / (4 - under) < threshold)
-      res[i] = threshold;
-    else
-      res[i] = values[i] / sum - delta / (4 - under);
-  }
-
-  // Is there a way to do it in one step?
-  if (abs(res.sum() - 1) > 1e-10)
-    res = normalise(res, threshold);
-
+  Eigen::VectorXd res{values};
+  normalise_inplace(res, threshold);
   return res;
 }
 
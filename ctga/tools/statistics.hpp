@@ -46,6 +46,7 @@
 #include <eigen3/Eigen/Core>
 #include <gsl/gsl_statistics.h>
 
+#include <cmath>
 #include <map>
 #include <numeric>
 #include <utility>
@@ -176,6 +177,56 @@ double thinness(double val, const std::vector<double> &vec);
 Eigen::VectorXd normalise(const Eigen::VectorXd& values,
                           double threshold);
 
+/**
+ *  \brief Normalise the probabilities in place
+ *
+ *  Same result as normalise, without allocating: each pass raises the values
+ *  below the threshold to it and takes the excess from the others, until
+ *  they sum to one. A pass clamps at least one more value, so there are at
+ *  most as many passes as values. Values summing to zero become uniform.
+ *
+ *  \param values Values to normalise, any Eigen vector expression that can
+ *  be written to (a column of a matrix, a fixed size vector...)
+ *  \param threshold Minimum authorized value
+ */
+template <typename Derived>
+void normalise_inplace(const Eigen::MatrixBase<Derived>& values,
+                       double threshold) {
+  // Eigen's way of writing to a temporary expression such as m.col(i)
+  auto& v = const_cast<Eigen::MatrixBase<Derived>&>(values);
+  using Scalar = typename Derived::Scalar;
+  const auto n = static_cast<unsigned>(v.size());
+
+  for (auto pass = 0U; pass <= n; ++pass) {
+    double sum = v.sum();
+    if (pass > 0 && std::abs(sum - 1.) <= 1e-10) return;
+    // Nothing to scale: every value is at its minimum
+    if (!(sum > 0.)) {
+      v.setConstant(Scalar(1. / n));
+      return;
+    }
+
+    // Values that would be below the threshold after normalization
+    unsigned under{};
+    double delta{};
+    for (auto i = 0U; i < n; ++i)
+      if (v[i] / sum < threshold) {
+        under++;
+        delta += threshold - v[i] / sum;
+      }
+    // Every value is under the threshold: nothing left to take from
+    if (under == n) {
+      v.setConstant(Scalar(1. / n));
+      return;
+    }
+
+    for (auto i = 0U; i < n; ++i) {
+      double x = v[i] / sum - delta / (n - under);
+      v[i] = Scalar(x < threshold ? threshold : x);
+    }
+  }
+}
+
 
 
 }  // namespace statistics
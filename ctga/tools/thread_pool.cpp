@@ -0,0 +1,94 @@
+// thread_pool.cpp ---
+//
+// Filename: thread_pool.cpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-22T10:31:44+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+#include "ctga/tools/thread_pool.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace ctga {
+namespace tools {
+
+ThreadPool* ThreadPool::get() {
+  static ThreadPool pool{0};
+  return &pool;
+}
+
+ThreadPool::ThreadPool(unsigned threads) :
+    workers_{}, tasks_{}, mutex_{}, ready_{}, stop_{false} {
+  if (threads == 0)
+    threads = std::max(1U, std::thread::hardware_concurrency());
+  workers_.reserve(threads);
+  for (auto i = 0U; i < threads; ++i)
+    workers_.emplace_back([this] { run(); });
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    stop_ = true;
+  }
+  ready_.notify_all();
+  for (auto& w : workers_) w.join();
+}
+
+void ThreadPool::run() {
+  for (;;) {
+    std::function<void()> task{};
+    {
+      std::unique_lock<std::mutex> lock{mutex_};
+      ready_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+      if (tasks_.empty()) return;
+      task = std::move(tasks_.front());
+      tasks_.pop();
+    }
+    task();
+  }
+}
+
+}  // namespace tools
+}  // namespace ctga
+
+//
+// thread_pool.cpp ends here
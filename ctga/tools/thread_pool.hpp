@@ -0,0 +1,135 @@
+// thread_pool.hpp ---
+//
+// Filename: thread_pool.hpp
+// Description:
+// Author: Vincent Berthier
+// Maintainer:
+// Copyright 2018 <Vincent Berthier>
+// Created: 2018-03-22T10:31:44+0000
+// Version:
+// Last-Updated:
+//           By:
+//     Update #: 0
+//
+
+// Commentary:
+//
+//
+//
+//
+
+// Change Log:
+//
+//
+//
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+
+// Code:
+
+
+#ifndef CTGA_TOOLS_THREAD_POOL_HPP_
+#define CTGA_TOOLS_THREAD_POOL_HPP_
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ctga {
+namespace tools {
+
+/**
+ *  \brief Fixed set of threads running submitted tasks
+ *
+ *  Tasks are run in submission order by the first available thread. A task
+ *  must not wait for another task of the same pool, which could leave every
+ *  thread waiting.
+ */
+class ThreadPool {
+ public:
+  /**
+   *  \brief Get or construct the pool shared by the whole program
+   *
+   *  \return Pointer to the pool, with a thread per hardware thread
+   */
+  static ThreadPool* get();
+
+  /**
+   *  \brief Starts the threads
+   *
+   *  \param threads Number of threads, 0 for one per hardware thread
+   */
+  explicit ThreadPool(unsigned threads);
+
+  /**
+   *  \brief Runs the pending tasks and joins the threads
+   */
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /**
+   *  \brief Get the number of threads
+   *
+   *  \return Number of threads
+   */
+  inline unsigned size() const { return workers_.size(); }
+
+  /**
+   *  \brief Submit a task
+   *
+   *  \param f Task, called without argument
+   *  \return Future of the result of the task, holding its exception if it
+   *  throws
+   */
+  template <typename F>
+  auto submit(F f) -> std::future<decltype(f())> {
+    auto task = std::make_shared<std::packaged_task<decltype(f())()>>(
+        std::move(f));
+    auto res = task->get_future();
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      tasks_.emplace([task] { (*task)(); });
+    }
+    ready_.notify_one();
+    return res;
+  }
+
+ private:
+  std::vector<std::thread> workers_;         /*!< Threads of the pool */
+  std::queue<std::function<void()>> tasks_;  /*!< Pending tasks */
+  std::mutex mutex_;                         /*!< Protects tasks_ and stop_ */
+  std::condition_variable ready_;            /*!< Signals new tasks or stop */
+  bool stop_;                                /*!< Set when destroyed */
+
+  // Loop of each thread
+  void run();
+};
+
+}  // namespace tools
+}  // namespace ctga
+
+#endif  // CTGA_TOOLS_THREAD_POOL_HPP_
+
+//
+// thread_pool.hpp ends here